@@ -0,0 +1,39 @@
+#!/bin/bash
+
+# Requires a build with -DCAF_NET_BENCH_ALLOC_STATS=ON. The durations go to
+# `<out_file>.out` as usual. Every successful run appends its statistics to
+# `<out_file>.alloc`, prefixed with the message size:
+#   <size>, alloc, <side>, <allocations>, <bytes>, <allocs/msg>, <bytes/msg>,
+#     <peak live bytes>
+#   <size>, rss, process, <steady-state kB>, <peak kB>
+
+output_folder="evaluation/out"
+mkdir -p ${output_folder}
+
+source "$(dirname "$0")/common.sh"
+
+function collect_allocs() {
+  grep -E "^(alloc|rss), " ${1}.err | sed "s/^/${2}, /" >> ${1}.alloc
+}
+
+for mode in netBench ioBench; do
+  for bench in blank_streaming_tcp pingpong_tcp; do
+    out_file="evaluation/out/allocations-${bench}-${mode}"
+    echo "-- allocations-${bench}-${mode} -----------------------------------------"
+    init_file message_size ${out_file} 10
+    : > ${out_file}.alloc
+    message_size=1
+    while [ $message_size -le 140000 ]; do
+      begin_point ${out_file} ${message_size}
+      for i in {1..10}; do
+        if [ ${bench} = pingpong_tcp ]; then
+          run_benchmark ${out_file} ./release/${bench} -m${mode} -s${message_size} -p10000 --alloc-stats --deadline=${run_timeout}
+        else
+          run_benchmark ${out_file} ./release/${bench} -m${mode} -s${message_size} -a104857600 --alloc-stats --deadline=${run_timeout}
+        fi && collect_allocs ${out_file} ${message_size}
+      done;
+      end_point ${out_file}
+      message_size=$((message_size*2))
+    done;
+  done;
+done;
@@ -0,0 +1,22 @@
+#!/bin/bash
+
+output_folder="evaluation/out"
+mkdir -p ${output_folder}
+
+source "$(dirname "$0")/common.sh"
+
+# Each run prints one row per layer: layer, duration_us, mib_s (see README).
+for mode in stages netBench ioBench; do
+  out_file="evaluation/out/basp-pipeline-${mode}"
+  echo "-- basp-pipeline-${mode} -------------------------------------------------"
+  init_file message_size ${out_file} 10
+  message_size=512
+  while [ $message_size -le 140000 ]; do
+    begin_point ${out_file} ${message_size}
+    for i in {1..10}; do
+      run_benchmark ${out_file} ./release/basp_pipeline -m${mode} -s${message_size} -a104857600 --deadline=${run_timeout}
+    done;
+    end_point ${out_file}
+    message_size=$((message_size*2))
+  done;
+done;
@@ -0,0 +1,22 @@
+#!/bin/bash
+
+output_folder="evaluation/out"
+mkdir -p ${output_folder}
+
+source "$(dirname "$0")/common.sh"
+
+# Throughput over the number of 512 byte payloads packed into one message.
+for mode in netBench ioBench; do
+  out_file="evaluation/out/blank-streaming-batching-${mode}"
+  echo "-- blank-streaming-batching-${mode} -----------------------------------"
+  init_file batch_size ${out_file} 10
+  batch_size=1
+  while [ $batch_size -le 1024 ]; do
+    begin_point ${out_file} ${batch_size}
+    for i in {1..10}; do
+      run_benchmark ${out_file} ./release/blank_streaming_tcp -m${mode} -s512 -b${batch_size} -a104857600 --deadline=${run_timeout}
+    done;
+    end_point ${out_file}
+    batch_size=$((batch_size*2))
+  done;
+done;
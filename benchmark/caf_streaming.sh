@@ -3,41 +3,50 @@
 output_folder="evaluation/out"
 mkdir -p ${output_folder}
 
-function init_file() {
-  printf "${1}, " > ${2}.out
-  for i in 1 2 3 4 5 6 7 8 9 10; do
-    printf "value${i}, " >> ${2}.out
-  done;
-  echo "" >> ${2}.out
-}
+source "$(dirname "$0")/common.sh"
 
 out_file="evaluation/out/caf-streaming-net-remote-nodes"
 echo "-- caf-streaming-net-remote-nodes --------------------------------------"
-init_file remote_nodes ${out_file}
+init_file remote_nodes ${out_file} 10
 for remote_nodes in {1..32}; do
   echo "-- ${remote_nodes} nodes -----------------------------------------------"
-  printf "${remote_nodes}, " >> ${out_file}.out
+  begin_point ${out_file} ${remote_nodes}
   for i in 0 1 2 3 4 5 6 7 8 9; do
-    while : ; do
-      ./release/caf_streaming_tcp -mnetBench -n$remote_nodes -a1073741824 >> ${out_file}.out 2> ${out_file}.err
-      [[ $? != 0 ]] || break # if program exited with error rerun it.
-    done;
+    run_benchmark ${out_file} ./release/caf_streaming_tcp -mnetBench -n$remote_nodes -a1073741824 --deadline=${run_timeout}
   done;
+  end_point ${out_file}
 done;
 
 echo "-- ioBenchmark ---------------------------------------------------------"
 
 out_file="evaluation/out/caf-streaming-io-remote-nodes"
 echo "-- caf-streaming-io-remote-nodes --------------------------------------"
-init_file remote_nodes ${out_file}
+init_file remote_nodes ${out_file} 10
 for remote_nodes in {1..32}; do
   echo "-- ${remote_nodes} nodes -----------------------------------------------"
-  printf "${remote_nodes}, " >> ${out_file}.out
+  begin_point ${out_file} ${remote_nodes}
   for i in 0 1 2 3 4 5 6 7 8 9; do
-    while : ; do
-      ./release/caf_streaming_tcp -mioBench -n$remote_nodes -a1073741824 >> ${out_file}.out 2> ${out_file}.err
-      [[ $? != 0 ]] || break # if program exited with error rerun it.
-    done;
+    run_benchmark ${out_file} ./release/caf_streaming_tcp -mioBench -n$remote_nodes -a1073741824 --deadline=${run_timeout}
   done;
+  end_point ${out_file}
 done;
 
+
+# Streams chunks instead of single bytes. Each file sweeps the chunk size for
+# one setting of the batch size the sink's size policy aims for.
+for mode in netBench ioBench; do
+  for bytes_per_batch in 2048 16384 131072 1048576; do
+    out_file="evaluation/out/caf-streaming-${mode}-chunks-${bytes_per_batch}"
+    echo "-- caf-streaming-${mode}-chunks-${bytes_per_batch} -------------------"
+    init_file chunk_size ${out_file} 10
+    chunk_size=64
+    while [ $chunk_size -le 65536 ]; do
+      begin_point ${out_file} ${chunk_size}
+      for i in 0 1 2 3 4 5 6 7 8 9; do
+        run_benchmark ${out_file} ./release/caf_streaming_tcp -m${mode} -c${chunk_size} -a1073741824 --caf.stream.size-policy.bytes-per-batch=${bytes_per_batch} --deadline=${run_timeout}
+      done;
+      end_point ${out_file}
+      chunk_size=$((chunk_size*4))
+    done;
+  done;
+done;
@@ -0,0 +1,102 @@
+#!/bin/bash
+
+# Shared helpers for the benchmark sweeps. Source this file from the scripts.
+#
+# Every run gets a deadline instead of being retried until it succeeds. Failed
+# runs are retried up to `max_retries` times, and each sweep point records its
+# failures, timeouts and retries in `<out_file>.failures`. Runs that never
+# succeed show up as `NA` in the output file.
+
+# Seconds a single run may take before it is aborted.
+run_timeout=${RUN_TIMEOUT:-300}
+# How often a failed run is repeated before it is recorded as missing.
+max_retries=${MAX_RETRIES:-3}
+
+function init_file() {
+  printf "${1}, " > ${2}.out
+  for i in $(seq 1 ${3:-50}); do
+    printf "value${i}, " >> ${2}.out
+  done;
+  echo "" >> ${2}.out
+  echo "${1}, runs, failures, timeouts, retries, missing" > ${2}.failures
+}
+
+# Starts a new sweep point.
+#   $1: output file without extension
+#   $2: value of the swept parameter
+function begin_point() {
+  point_value=$2
+  point_runs=0
+  point_failures=0
+  point_timeouts=0
+  point_retries=0
+  point_missing=0
+  printf "${point_value}, " >> ${1}.out
+}
+
+# Finishes the current sweep point and records its failure statistics.
+#   $1: output file without extension
+function end_point() {
+  echo "" >> ${1}.out
+  echo "${point_value}, ${point_runs}, ${point_failures}, ${point_timeouts}, ${point_retries}, ${point_missing}" >> ${1}.failures
+}
+
+# Runs a benchmark until it succeeds, at most `max_retries` + 1 times, and
+# records failures for the current sweep point. Stores the output of the
+# successful attempt in `run_result`.
+#   $1: output file without extension
+#   $@: benchmark command
+function run_attempts() {
+  local out_file=$1
+  shift
+  point_runs=$((point_runs+1))
+  for attempt in $(seq 0 ${max_retries}); do
+    if [ $attempt -gt 0 ]; then
+      point_retries=$((point_retries+1))
+    fi
+    run_result=$(timeout --kill-after=10 $((run_timeout+10)) "$@" 2> ${out_file}.err)
+    local status=$?
+    if [ $status -eq 0 ]; then
+      return 0
+    fi
+    point_failures=$((point_failures+1))
+    if [ $status -eq 124 ] || [ $status -eq 137 ]; then
+      point_timeouts=$((point_timeouts+1))
+    fi
+    echo "-- ${point_value}: attempt ${attempt} exited with ${status}: $*" >> ${out_file}.failed.err
+    cat ${out_file}.err >> ${out_file}.failed.err
+  done;
+  point_missing=$((point_missing+1))
+  return 1
+}
+
+# Runs a benchmark once, retrying failed attempts up to `max_retries` times.
+#   $1: output file without extension
+#   $@: benchmark command
+function run_benchmark() {
+  local out_file=$1
+  if run_attempts "$@"; then
+    printf "%s" "${run_result}" >> ${out_file}.out
+    return 0
+  fi
+  printf "NA, " >> ${out_file}.out
+  return 1
+}
+
+# Like `run_benchmark`, but for benchmarks that print whole CSV rows. Appends
+# the rows to `$2` and marks the run as `ok` or `NA` in `<out_file>.out`.
+#   $1: output file without extension
+#   $2: file that collects the rows
+#   $@: benchmark command
+function run_rows() {
+  local out_file=$1
+  local rows_file=$2
+  shift 2
+  if run_attempts ${out_file} "$@"; then
+    echo "${run_result}" >> ${rows_file}
+    printf "ok, " >> ${out_file}.out
+    return 0
+  fi
+  printf "NA, " >> ${out_file}.out
+  return 1
+}
@@ -0,0 +1,39 @@
+#!/bin/bash
+
+# Streams 100 MiB through the compression stage at several emulated
+# bandwidths. The durations go to `<out_file>.out` as usual. Every successful
+# run appends its statistics to `<out_file>.compression`, prefixed with the
+# bandwidth:
+#   <bandwidth>, compression, <codec>, <raw bytes>, <wire bytes>, <ratio>,
+#     <compress cpu us>, <decompress cpu us>, <goodput MiB/s>
+# A bandwidth of 0 disables the emulation.
+
+output_folder="evaluation/out"
+mkdir -p ${output_folder}
+
+source "$(dirname "$0")/common.sh"
+
+function collect_stats() {
+  grep -E "^compression, " ${1}.err | sed "s/^/${2}, /" >> ${1}.compression
+}
+
+message_size=16384
+for codec in none zlib; do
+  for bench in blank_streaming_tcp streaming_raw_tcp; do
+    out_file="evaluation/out/compression-${bench}-${codec}"
+    echo "-- compression-${bench}-${codec} ------------------------------------------"
+    init_file bandwidth ${out_file} 10
+    : > ${out_file}.compression
+    for bandwidth in 0 1048576 10485760 104857600 1073741824; do
+      begin_point ${out_file} ${bandwidth}
+      for i in {1..10}; do
+        if [ ${bench} = streaming_raw_tcp ]; then
+          run_benchmark ${out_file} ./release/${bench} -m${message_size} -a104857600 -B${bandwidth} -z${codec} -t${run_timeout}
+        else
+          run_benchmark ${out_file} ./release/${bench} -mnetBench -s${message_size} -a104857600 --netem.bandwidth=${bandwidth} --compression=${codec} --deadline=${run_timeout}
+        fi && collect_stats ${out_file} ${bandwidth}
+      done;
+      end_point ${out_file}
+    done;
+  done;
+done;
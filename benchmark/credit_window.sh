@@ -0,0 +1,22 @@
+#!/bin/bash
+
+output_folder="evaluation/out"
+mkdir -p ${output_folder}
+
+source "$(dirname "$0")/common.sh"
+
+# Throughput over the credit window of the sink, counted in messages.
+for mode in netBench ioBench; do
+  out_file="evaluation/out/blank-streaming-credit-window-${mode}"
+  echo "-- blank-streaming-credit-window-${mode} ------------------------------"
+  init_file window ${out_file} 10
+  window=1
+  while [ $window -le 65536 ]; do
+    begin_point ${out_file} ${window}
+    for i in {1..10}; do
+      run_benchmark ${out_file} ./release/blank_streaming_tcp -m${mode} -s1024 -a104857600 --credit=${window} --deadline=${run_timeout}
+    done;
+    end_point ${out_file}
+    window=$((window*4))
+  done;
+done;
@@ -0,0 +1,33 @@
+#!/bin/bash
+
+# Streams 100 MiB in both directions over each connection at once. The
+# durations until both directions finished go to `<out_file>.out` as usual.
+# Every successful run appends the throughput per direction to
+# `<out_file>.direction`, prefixed with the message size and the run:
+#   <size>, <run>, direction, <up|down>, <duration_us>, <MiB/s>
+
+output_folder="evaluation/out"
+mkdir -p ${output_folder}
+
+source "$(dirname "$0")/common.sh"
+
+function collect_directions() {
+  grep -E "^direction, " ${1}.err | sed "s/^/${2}, ${3}, /" >> ${1}.direction
+}
+
+for mode in netBench ioBench; do
+  out_file="evaluation/out/duplex-streaming-${mode}"
+  echo "-- duplex-streaming-${mode} -----------------------------------------------"
+  init_file message_size ${out_file} 10
+  : > ${out_file}.direction
+  message_size=512
+  while [ $message_size -le 140000 ]; do
+    begin_point ${out_file} ${message_size}
+    for i in {1..10}; do
+      run_benchmark ${out_file} ./release/blank_streaming_tcp -m${mode} -s${message_size} -a104857600 --duplex --deadline=${run_timeout} \
+        && collect_directions ${out_file} ${message_size} ${i}
+    done;
+    end_point ${out_file}
+    message_size=$((message_size*2))
+  done;
+done;
@@ -0,0 +1,25 @@
+#!/bin/bash
+
+# Sends a single payload of 16 MiB up to 2 GiB in every mode. The rows of all
+# runs go to `<out_file>.csv`, and `<out_file>.failures` counts failed runs per
+# size. Meaningful peak heap columns require a build
+# with --enable-alloc-stats, and 2 GiB runs need several GiB of free memory.
+
+output_folder="evaluation/out"
+mkdir -p ${output_folder}
+
+source "$(dirname "$0")/common.sh"
+
+for mode in raw netBench ioBench; do
+  out_file="evaluation/out/large-message-${mode}"
+  echo "-- large-message-${mode} --------------------------------------------------"
+  echo "mode, size, count, ttfb_us, total_us, mib_s, wire_bytes, sender_peak_bytes, receiver_peak_bytes, sender_copies, receiver_copies, rss_growth_kb" > ${out_file}.csv
+  init_file size_mib ${out_file} 5
+  for mib in 16 64 256 1024 2048; do
+    begin_point ${out_file} ${mib}
+    for i in {1..5}; do
+      run_rows ${out_file} ${out_file}.csv ./release/large_message -m${mode} -s$((mib*1024*1024)) --deadline=${run_timeout}
+    done;
+    end_point ${out_file}
+  done;
+done;
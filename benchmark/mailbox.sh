@@ -0,0 +1,37 @@
+#!/bin/bash
+
+# Samples the mailboxes of the sink and pong actors every 10 ms. The durations
+# go to `<out_file>.out` as usual. Every successful run appends its samples to
+# `<out_file>.mailbox`, prefixed with the message size and the run:
+#   <size>, <run>, mailbox, <role>, <actor id>, <t_ms>, <depth>, <delay_us>
+
+output_folder="evaluation/out"
+mkdir -p ${output_folder}
+
+source "$(dirname "$0")/common.sh"
+
+function collect_samples() {
+  grep -E "^mailbox, " ${1}.err | sed "s/^/${2}, ${3}, /" >> ${1}.mailbox
+}
+
+for mode in netBench ioBench; do
+  for bench in blank_streaming_tcp pingpong_tcp; do
+    out_file="evaluation/out/mailbox-${bench}-${mode}"
+    echo "-- mailbox-${bench}-${mode} ---------------------------------------------"
+    init_file message_size ${out_file} 10
+    : > ${out_file}.mailbox
+    message_size=1
+    while [ $message_size -le 140000 ]; do
+      begin_point ${out_file} ${message_size}
+      for i in {1..10}; do
+        if [ ${bench} = pingpong_tcp ]; then
+          run_benchmark ${out_file} ./release/${bench} -m${mode} -s${message_size} -p10000 --mailbox-sampling=10 --deadline=${run_timeout}
+        else
+          run_benchmark ${out_file} ./release/${bench} -m${mode} -s${message_size} -a104857600 --mailbox-sampling=10 --deadline=${run_timeout}
+        fi && collect_samples ${out_file} ${message_size} ${i}
+      done;
+      end_point ${out_file}
+      message_size=$((message_size*4))
+    done;
+  done;
+done;
@@ -0,0 +1,31 @@
+#!/bin/bash
+
+# Sweeps the share of 4 MiB messages among 64 byte messages. Every successful
+# run appends the latency rows to `<out_file>.latency`, prefixed with the share
+# of large messages in per mille and the run:
+#   <large_permille>, <run>, <class>_latency_us, <count>, <p50>, <p90>, <p99>, <p99.9>, <max>
+
+output_folder="evaluation/out"
+mkdir -p ${output_folder}
+
+source "$(dirname "$0")/common.sh"
+
+function collect_latencies() {
+  grep -E "^(small|large)_latency_us, " ${1}.err | sed "s/^/${2}, ${3}, /" >> ${1}.latency
+}
+
+for mode in netBench ioBench; do
+  out_file="evaluation/out/mixed-sizes-${mode}"
+  echo "-- mixed-sizes-${mode} ----------------------------------------------------"
+  init_file large_permille ${out_file} 10
+  : > ${out_file}.latency
+  for permille in 0 1 5 10 50 100; do
+    fraction=$(awk "BEGIN { print ${permille} / 1000 }")
+    begin_point ${out_file} ${permille}
+    for i in {1..10}; do
+      run_benchmark ${out_file} ./release/mixed_sizes_tcp -m${mode} --messages=10000 --large-fraction=${fraction} --rate=20000 --data.seed=${i} --deadline=${run_timeout} \
+        && collect_latencies ${out_file} ${permille} ${i}
+    done;
+    end_point ${out_file}
+  done;
+done;
@@ -0,0 +1,33 @@
+#!/bin/bash
+
+output_folder="evaluation/out"
+mkdir -p ${output_folder}
+
+source "$(dirname "$0")/common.sh"
+
+# Sweeps the number of ping/pong pairs sharing a single connection. Besides the
+# durations in `<out_file>.out`, every successful run appends to
+# `<out_file>.pairs`, prefixed with the number of pairs:
+#   <M>, pairs, <pairs>, <round trips/s>
+#   <M>, pair_rtt_us, <min>, <p50>, <p90>, <p99>, <max>
+#   <M>, rtt_us, <p50>, <p90>, <p99>, <p99.9>, <max>
+
+function collect_pairs() {
+  grep -E "^(pairs|pair_rtt_us|rtt_us), " ${1}.err | sed "s/^/${2}, /" >> ${1}.pairs
+}
+
+for mode in netBench ioBench; do
+  out_file="evaluation/out/pingpong-multiplexed-${mode}"
+  echo "-- pingpong-multiplexed-${mode} ---------------------------------------"
+  init_file actors_per_node ${out_file} 10
+  : > ${out_file}.pairs
+  actors=1
+  while [ $actors -le 1024 ]; do
+    begin_point ${out_file} ${actors}
+    for i in {1..10}; do
+      run_benchmark ${out_file} ./release/pingpong_tcp -m${mode} -M${actors} -s1024 -p1000 --deadline=${run_timeout} && collect_pairs ${out_file} ${actors}
+    done;
+    end_point ${out_file}
+    actors=$((actors*4))
+  done;
+done;
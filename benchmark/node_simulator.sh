@@ -0,0 +1,22 @@
+#!/bin/bash
+
+output_folder="evaluation/out"
+mkdir -p ${output_folder}
+
+source "$(dirname "$0")/common.sh"
+
+# Each run prints one row: nodes, duration_us, mib_s,
+# rss_per_connection_bytes, poll_us, cpu_us_per_msg. The RSS per connection
+# covers both ends, since the simulated nodes run in the same process.
+out_file="evaluation/out/node-simulator"
+echo "-- node-simulator ----------------------------------------------------------"
+init_file num_nodes ${out_file} 10
+num_nodes=16
+while [ $num_nodes -le 4096 ]; do
+  begin_point ${out_file} ${num_nodes}
+  for i in {1..10}; do
+    run_benchmark ${out_file} ./release/node_simulator -n${num_nodes} -s1024 -a1048576 --deadline=${run_timeout}
+  done;
+  end_point ${out_file}
+  num_nodes=$((num_nodes*2))
+done;
@@ -3,13 +3,7 @@
 output_folder="evaluation/out"
 mkdir -p ${output_folder}
 
-function init_file() {
-  printf "${1}, " > ${2}.out
-  for i in {1..50}; do
-    printf "value${i}, " >> ${2}.out
-  done;
-  echo "" >> ${2}.out
-}
+source "$(dirname "$0")/common.sh"
 
 # echo "-- raw benchmark ------------------------------------------------------"
 
@@ -19,14 +13,11 @@ function init_file() {
 # message_size=1
 # while [ $message_size -le 4096 ]; do
 #   echo "-- message-size = ${message_size} -----------------------------------"
-#   printf "${message_size}, " >> ${out_file}.out
+#   begin_point ${out_file} ${message_size}
 #   for i in {0..50}; do
-#     while : ; do
-#       ./release/pingpong_raw_tcp -a10000 -m$message_size >> ${out_file}.out 2> ${out_file}.err
-#       [[ $? != 0 ]] || break # if program exited with error rerun it.
-#     done;
+#     run_benchmark ${out_file} ./release/pingpong_raw_tcp -a10000 -m$message_size -t${run_timeout}
 #   done;
-#   echo "" >> ${out_file}.out
+#   end_point ${out_file}
 #   message_size=$((message_size*2))
 # done;
 
@@ -38,14 +29,11 @@ function init_file() {
 # message_size=1
 # while [ $message_size -le 4096 ]; do
 #   echo "-- message-size = ${message_size} -----------------------------------"
-#   printf "${message_size}, " >> ${out_file}.out
+#   begin_point ${out_file} ${message_size}
 #   for i in {0..50}; do
-#     while : ; do
-#       ./release/pingpong_tcp -mnetBench -p10000 -s$message_size >> ${out_file}.out 2> ${out_file}.err
-#       [[ $? != 0 ]] || break # if program exited with error rerun it.
-#     done;
+#     run_benchmark ${out_file} ./release/pingpong_tcp -mnetBench -p10000 -s$message_size --deadline=${run_timeout}
 #   done;
-#   echo "" >> ${out_file}.out
+#   end_point ${out_file}
 #   message_size=$((message_size*2))
 # done;
 
@@ -57,14 +45,11 @@ init_file message_size ${out_file}
 message_size=1
 while [ $message_size -le 4096 ]; do
   echo "-- message-size = ${message_size} -----------------------------------"
-  printf "${message_size}, " >> ${out_file}.out
+  begin_point ${out_file} ${message_size}
   for i in {0..50}; do
-    while : ; do
-      ./release/pingpong_udp -p10000 -s$message_size >> ${out_file}.out 2> ${out_file}.err
-      [[ $? != 0 ]] || break # if program exited with error rerun it.
-    done;
+    run_benchmark ${out_file} ./release/pingpong_udp -p10000 -s$message_size --deadline=${run_timeout}
   done;
-  echo "" >> ${out_file}.out
+  end_point ${out_file}
   message_size=$((message_size*2))
 done;
 
@@ -76,13 +61,10 @@ init_file message_size ${out_file}
 message_size=1
 while [ $message_size -le 4096 ]; do
   echo "-- message-size = ${message_size} -----------------------------------"
-  printf "${message_size}, " >> ${out_file}.out
+  begin_point ${out_file} ${message_size}
   for i in {0..50}; do
-    while : ; do
-      ./release/pingpong_tcp -mioBench -p10000 -s$message_size >> ${out_file}.out 2> ${out_file}.err
-      [[ $? != 0 ]] || break # if program exited with error rerun it.
-    done;
+    run_benchmark ${out_file} ./release/pingpong_tcp -mioBench -p10000 -s$message_size --deadline=${run_timeout}
   done;
-  echo "" >> ${out_file}.out
+  end_point ${out_file}
   message_size=$((message_size*2))
 done;
@@ -0,0 +1,37 @@
+#!/bin/bash
+
+output_folder="evaluation/out"
+mkdir -p ${output_folder}
+
+source "$(dirname "$0")/common.sh"
+
+# Sweeps the number of pings in flight from 1 to 1024 for raw sockets, io and
+# net. Besides the durations in `<out_file>.out`, every successful run appends
+# its throughput and round trip percentiles to `<out_file>.window`, prefixed
+# with the window:
+#   <W>, pairs, 1, <round trips/s>
+#   <W>, rtt_us, <p50>, <p90>, <p99>, <p99.9>, <max>
+
+function collect_window() {
+  grep -E "^(pairs|rtt_us), " ${1}.err | sed "s/^/${2}, /" >> ${1}.window
+}
+
+for mode in raw netBench ioBench; do
+  out_file="evaluation/out/pingpong-pipelined-${mode}"
+  echo "-- pingpong-pipelined-${mode} -------------------------------------------"
+  init_file window ${out_file} 10
+  : > ${out_file}.window
+  window=1
+  while [ $window -le 1024 ]; do
+    begin_point ${out_file} ${window}
+    for i in {1..10}; do
+      if [ ${mode} = raw ]; then
+        run_benchmark ${out_file} ./release/pingpong_raw_tcp -a100000 -m1024 -w${window} -t${run_timeout}
+      else
+        run_benchmark ${out_file} ./release/pingpong_tcp -m${mode} -s1024 -p100000 -w${window} --deadline=${run_timeout}
+      fi && collect_window ${out_file} ${window}
+    done;
+    end_point ${out_file}
+    window=$((window*2))
+  done;
+done;
@@ -0,0 +1,39 @@
+#!/bin/bash
+
+output_folder="evaluation/out"
+mkdir -p ${output_folder}
+
+source "$(dirname "$0")/common.sh"
+
+# Runs the plain ping-pong and the request/response variant side by side. Every
+# successful run appends its round trip percentiles to `<out_file>.rtt`,
+# prefixed with the message size:
+#   <size>, rtt_us, <p50>, <p90>, <p99>, <p99.9>, <max>
+
+function collect_rtts() {
+  grep -E "^rtt_us, " ${1}.err | sed "s/^/${2}, /" >> ${1}.rtt
+}
+
+for mode in netBench ioBench; do
+  for variant in send request; do
+    # The plain variant needs --timed to report round trip times.
+    flags="--timed"
+    if [ ${variant} = request ]; then
+      flags="--request-response"
+    fi
+    out_file="evaluation/out/pingpong-${variant}-${mode}"
+    echo "-- pingpong-${variant}-${mode} ------------------------------------------"
+    init_file message_size ${out_file} 10
+    : > ${out_file}.rtt
+    message_size=1
+    while [ $message_size -le 140000 ]; do
+      begin_point ${out_file} ${message_size}
+      for i in {1..10}; do
+        run_benchmark ${out_file} ./release/pingpong_tcp -m${mode} -s${message_size} -p10000 ${flags} --deadline=${run_timeout} \
+          && collect_rtts ${out_file} ${message_size}
+      done;
+      end_point ${out_file}
+      message_size=$((message_size*4))
+    done;
+  done;
+done;
@@ -0,0 +1,18 @@
+#!/bin/bash
+
+output_folder="evaluation/out"
+mkdir -p ${output_folder}
+
+source "$(dirname "$0")/common.sh"
+
+# Each run prints a complete table, so the runs are numbered instead of swept.
+out_file="evaluation/out/serialization"
+echo "-- serialization ----------------------------------------------------------"
+init_file run ${out_file} 1
+for i in {1..10}; do
+  echo "-- run ${i} ---------------------------------------------------------------"
+  : > ${out_file}-${i}.csv
+  begin_point ${out_file} ${i}
+  run_rows ${out_file} ${out_file}-${i}.csv ./release/serialization -t${run_timeout}
+  end_point ${out_file}
+done;
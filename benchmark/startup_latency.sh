@@ -0,0 +1,21 @@
+#!/bin/bash
+
+output_folder="evaluation/out"
+mkdir -p ${output_folder}
+
+source "$(dirname "$0")/common.sh"
+
+# Each run prints one row per joining node, so the runs are numbered instead of
+# swept.
+for mode in netBench ioBench; do
+  out_file="evaluation/out/startup-latency-${mode}"
+  echo "-- startup-latency-${mode} ------------------------------------------------"
+  init_file run ${out_file} 1
+  for i in {1..10}; do
+    echo "-- run ${i} ---------------------------------------------------------------"
+    : > ${out_file}-${i}.csv
+    begin_point ${out_file} ${i}
+    run_rows ${out_file} ${out_file}-${i}.csv ./release/startup_latency -m${mode} -r100 --deadline=${run_timeout}
+    end_point ${out_file}
+  done;
+done;
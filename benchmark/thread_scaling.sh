@@ -0,0 +1,38 @@
+#!/bin/bash
+
+output_folder="evaluation/out"
+mkdir -p ${output_folder}
+
+source "$(dirname "$0")/common.sh"
+
+# Runs the same workload with growing thread counts on both the main system and
+# the remote nodes. `evaluation/thread_scaling.py` computes the efficiency.
+# Every successful ping-pong run also appends its round trip percentiles to
+# `<out_file>.rtt`, prefixed with the thread count:
+#   <threads>, rtt_us, <p50>, <p90>, <p99>, <p99.9>, <max>
+
+function collect_rtt() {
+  grep -E "^rtt_us, " ${1}.err | sed "s/^/${2}, /" >> ${1}.rtt
+}
+
+remote_nodes=${REMOTE_NODES:-16}
+for mode in netBench ioBench; do
+  for bench in blank_streaming_tcp pingpong_tcp; do
+    out_file="evaluation/out/thread-scaling-${bench}-${mode}"
+    echo "-- thread-scaling-${bench}-${mode} ----------------------------------"
+    init_file threads ${out_file} 10
+    : > ${out_file}.rtt
+    for threads in 1 2 4 8 16 32; do
+      begin_point ${out_file} ${threads}
+      for i in {1..10}; do
+        if [ ${bench} = pingpong_tcp ]; then
+          run_benchmark ${out_file} ./release/${bench} -m${mode} -n${remote_nodes} -s1024 -p10000 --timed --caf.scheduler.max-threads=${threads} --caf.middleman.workers=${threads} --deadline=${run_timeout} \
+            && collect_rtt ${out_file} ${threads}
+        else
+          run_benchmark ${out_file} ./release/${bench} -m${mode} -n${remote_nodes} -s1024 -a104857600 --caf.scheduler.max-threads=${threads} --caf.middleman.workers=${threads} --deadline=${run_timeout}
+        fi
+      done;
+      end_point ${out_file}
+    done;
+  done;
+done;
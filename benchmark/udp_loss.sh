@@ -0,0 +1,31 @@
+#!/bin/bash
+
+output_folder="evaluation/out"
+mkdir -p ${output_folder}
+
+source "$(dirname "$0")/common.sh"
+
+# Sweeps the datagram loss of the emulated link for the UDP ping-pong with 8
+# pings in flight and 10% reordering. Every successful run appends its
+# datagram accounting and round trip percentiles to `<out_file>.loss`,
+# prefixed with the loss in percent:
+#   <loss>, udp_pings, <pings>, <received>, <lost>, <loss rate>, <retransmits>, <duplicates>, <late>, <reordered>, <max reorder depth>
+#   <loss>, rtt_us, <p50>, <p90>, <p99>, <p99.9>, <max>
+
+function collect_loss() {
+  grep -E "^(udp_pings|rtt_us), " ${1}.err | sed "s/^/${2}, /" >> ${1}.loss
+}
+
+out_file="evaluation/out/pingpong-udp-loss"
+echo "-- pingpong-udp-loss -------------------------------------------------------"
+init_file loss_percent ${out_file} 10
+: > ${out_file}.loss
+for loss in 0 1 2 5 10 20; do
+  probability=$(awk "BEGIN { print ${loss} / 100 }")
+  begin_point ${out_file} ${loss}
+  for i in {1..10}; do
+    run_benchmark ${out_file} ./release/pingpong_udp -p10000 -s1024 -w8 --timeout=50 --retries=5 --netem.loss=${probability} --netem.reorder=0.1 --netem.latency=100 --netem.seed=${i} --deadline=${run_timeout} \
+      && collect_loss ${out_file} ${loss}
+  done;
+  end_point ${out_file}
+done;
@@ -0,0 +1,34 @@
+#!/bin/bash
+
+output_folder="evaluation/out"
+mkdir -p ${output_folder}
+
+source "$(dirname "$0")/common.sh"
+
+# Streams 100 MiB over UDP for every combination of send rate (bytes/s, 0 =
+# unpaced) and datagram size. Every successful run appends its summary to
+# `<out_file>.delivery` and its receive rate series to `<out_file>.rate`,
+# prefixed with rate and size:
+#   <rate>, <size>, udp_stream, <sink>, <expected>, <received>, <datagrams>, <delivered fraction>, <goodput MiB/s>, <end>
+#   <rate>, <size>, udp_rate, <sink>, <t_ms>, <MiB/s>
+
+function collect_delivery() {
+  grep -E "^udp_stream, " ${1}.err | sed "s/^/${2}, ${3}, /" >> ${1}.delivery
+  grep -E "^udp_rate, " ${1}.err | sed "s/^/${2}, ${3}, /" >> ${1}.rate
+}
+
+for rate in 0 10485760 52428800 104857600 524288000; do
+  out_file="evaluation/out/udp-streaming-rate-${rate}"
+  echo "-- udp-streaming-rate-${rate} ---------------------------------------------"
+  init_file message_size ${out_file} 10
+  : > ${out_file}.delivery
+  : > ${out_file}.rate
+  for message_size in 512 1024 4096 16384 65000; do
+    begin_point ${out_file} ${message_size}
+    for i in {1..10}; do
+      run_benchmark ${out_file} ./release/blank_streaming_udp -s${message_size} -a104857600 -r${rate} --deadline=${run_timeout} \
+        && collect_delivery ${out_file} ${rate} ${message_size}
+    done;
+    end_point ${out_file}
+  done;
+done;
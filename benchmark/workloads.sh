@@ -0,0 +1,28 @@
+#!/bin/bash
+
+output_folder="evaluation/out"
+mkdir -p ${output_folder}
+
+source "$(dirname "$0")/common.sh"
+
+# Repeats the streaming and ping-pong sweeps for every kind of payload data.
+for data in zeros random text structured; do
+  for bench in blank_streaming_tcp pingpong_tcp; do
+    out_file="evaluation/out/workload-${bench}-${data}"
+    echo "-- workload-${bench}-${data} ---------------------------------------------"
+    init_file message_size ${out_file} 10
+    message_size=64
+    while [ $message_size -le 140000 ]; do
+      begin_point ${out_file} ${message_size}
+      for i in {1..10}; do
+        if [ ${bench} = pingpong_tcp ]; then
+          run_benchmark ${out_file} ./release/${bench} -mnetBench -s${message_size} -p10000 --data.kind=${data} --data.seed=${i} --deadline=${run_timeout}
+        else
+          run_benchmark ${out_file} ./release/${bench} -mnetBench -s${message_size} -a104857600 --data.kind=${data} --data.seed=${i} --deadline=${run_timeout}
+        fi
+      done;
+      end_point ${out_file}
+      message_size=$((message_size*4))
+    done;
+  done;
+done;
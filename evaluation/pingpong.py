@@ -41,7 +41,8 @@ def calculate(file, label):
         continue
       split_line = line.rstrip(',\n').split(', ')
       message_size = int(split_line[0])
-      values = split_line[1:-1]
+      # Runs that failed after all retries are recorded as NA.
+      values = [v for v in split_line[1:-1] if v != 'NA']
       values = np.array(values).astype(np.long)
       for i in range(len(values)):
         message_sizes.append(message_size)
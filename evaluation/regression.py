@@ -38,7 +38,8 @@ def calculate(file):
         continue
       split_line = line.rstrip(',\n').split(', ')
       run = int(split_line[0])
-      values = split_line[1:]
+      # Runs that failed after all retries are recorded as NA.
+      values = [v for v in split_line[1:] if v != 'NA']
       values = np.array(values).astype(np.long)
       for r in range(run):
         runs.append(run)
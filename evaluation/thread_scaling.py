@@ -0,0 +1,74 @@
+#!/usr/bin/env python
+# -*- coding: utf-8 -*-
+
+"""
+Print the scaling efficiency and the round trip latency of the thread sweeps
+"""
+
+__maintainer__ = "Jakob Otto"
+__email__ = "jakob.otto@haw-hamburg.de"
+__copyright__ = "Copyright 2020"
+
+import numpy as np
+
+from pathlib import Path
+
+
+def read_medians(file):
+  medians = {}
+  with open(file, 'r', newline='') as f:
+    for i, line in enumerate(f):
+      # Skip first line with labels
+      if i == 0:
+        continue
+      split_line = line.rstrip(',\n').split(', ')
+      # Runs that failed after all retries are recorded as NA.
+      values = [v for v in split_line[1:] if v not in ('NA', '')]
+      if values:
+        medians[int(split_line[0])] = np.median(np.array(values).astype(float))
+  return medians
+
+
+def read_rtts(file):
+  # Maps the thread count to the percentile rows of all runs, each row being
+  # p50, p90, p99, p99.9 and max in microseconds.
+  rtts = {}
+  if not file.exists():
+    return rtts
+  with open(file, 'r', newline='') as f:
+    for line in f:
+      split_line = line.rstrip('\n').split(', ')
+      if len(split_line) < 7 or split_line[1] != 'rtt_us':
+        continue
+      rtts.setdefault(int(split_line[0]), []).append(
+        [float(v) for v in split_line[2:7]])
+  return rtts
+
+
+def main():
+  # Every run processes the same amount of work, so the speedup is the ratio of
+  # durations and the efficiency is the speedup per thread.
+  for file in sorted(Path('evaluation/out').glob('thread-scaling-*.out')):
+    medians = read_medians(file)
+    if 1 not in medians:
+      print(f'{file}: missing single-threaded baseline')
+      continue
+    print(f'-- {file.stem}')
+    print('threads, median_us, speedup, efficiency')
+    for threads, median in sorted(medians.items()):
+      speedup = medians[1] / median
+      print(f'{threads}, {median:.0f}, {speedup:.2f}, {speedup / threads:.2f}')
+    # Ping-pong sweeps also record latency. Taking the median of each
+    # percentile across runs keeps a single slow run from dominating.
+    rtts = read_rtts(file.with_suffix('.rtt'))
+    if rtts:
+      print('threads, rtt_p50_us, rtt_p90_us, rtt_p99_us, rtt_p999_us, '
+            'rtt_max_us')
+      for threads, rows in sorted(rtts.items()):
+        p50, p90, p99, p999, max_us = np.median(np.array(rows), axis=0)
+        print(f'{threads}, {p50:.0f}, {p90:.0f}, {p99:.0f}, {p999:.0f}, '
+              f'{max_us:.0f}')
+
+
+if __name__ == '__main__':
+  main()
@@ -0,0 +1,116 @@
+/******************************************************************************
+ *                       ____    _    _____                                   *
+ *                      / ___|  / \  |  ___|    C++                           *
+ *                     | |     / _ \ | |_       Actor                         *
+ *                     | |___ / ___ \|  _|      Framework                     *
+ *                      \____/_/   \_|_|                                      *
+ *                                                                            *
+ * Copyright 2011-2020 Jakob Otto                                             *
+ *                                                                            *
+ * Distributed under the terms and conditions of the BSD 3-Clause License or  *
+ * (at your option) under the terms and conditions of the Boost Software      *
+ * License 1.0. See accompanying files LICENSE and LICENSE_ALTERNATIVE.       *
+ *                                                                            *
+ * If you did not receive a copy of the license files, see                    *
+ * http://opensource.org/licenses/BSD-3-Clause and                            *
+ * http://www.boost.org/LICENSE_1_0.txt.                                      *
+ ******************************************************************************/
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "caf/fwd.hpp"
+
+// -- allocation counting ------------------------------------------------------
+
+// Counting requires replacing the global operator new, which only happens when
+// building with -DCAF_NET_BENCH_ALLOC_STATS=ON. Otherwise all counters stay
+// zero and `alloc_stats_enabled` returns false. Each block remembers the side
+// that allocated it, and freeing it debits that side, even when another side
+// frees it.
+
+/// Threads of the benchmark driver and the actor system in `caf_main`.
+constexpr size_t main_side = 0;
+
+/// Threads of the remote nodes.
+constexpr size_t node_side = 1;
+
+/// Threads that belong to neither side, e.g., the netem proxy.
+constexpr size_t other_side = 2;
+
+constexpr size_t num_sides = 3;
+
+struct alloc_snapshot {
+  uint64_t allocations = 0;
+  uint64_t deallocations = 0;
+  uint64_t bytes = 0;
+  uint64_t live_bytes = 0;
+  uint64_t peak_live_bytes = 0;
+};
+
+/// Returns whether the global operator new counts allocations.
+bool alloc_stats_enabled();
+
+/// Attributes all allocations of the calling thread to `side`.
+void set_alloc_side(size_t side);
+
+/// Attributes all allocations of threads launched by the actor system for
+/// `cfg` to `side`.
+void tag_threads(caf::actor_system_config& cfg, size_t side);
+
+/// Returns the counters of `side` since program start.
+alloc_snapshot alloc_stats(size_t side);
+
+/// Marks the start of the measured transfer and resets the peak live bytes of
+/// every side to its current live bytes. Only the first call has an effect.
+void mark_alloc_window_begin();
+
+/// Marks the end of the measured transfer. Only the last call counts.
+void mark_alloc_window_end();
+
+/// Prints allocations and bytes per message for every side, restricted to the
+/// marked window if available.
+void print_alloc_stats(std::ostream& out, size_t num_messages);
+
+// -- resident set size --------------------------------------------------------
+
+struct rss_info {
+  size_t current_kb = 0;
+  size_t peak_kb = 0;
+};
+
+/// Reads VmRSS and VmHWM of this process from /proc/self/status.
+rss_info read_rss();
+
+/// Samples the resident set size periodically on a background thread.
+class rss_sampler {
+public:
+  explicit rss_sampler(std::chrono::milliseconds interval
+                       = std::chrono::milliseconds(100));
+
+  ~rss_sampler();
+
+  void stop();
+
+  /// Returns the median of all samples taken between the first and last
+  /// quarter of the run, which filters out startup and shutdown.
+  size_t steady_kb();
+
+private:
+  std::atomic<bool> running_;
+  std::mutex mtx_;
+  std::vector<size_t> samples_;
+  std::thread thread_;
+};
+
+/// Stops `sampler` and prints the steady-state and peak resident set size of
+/// the whole process, i.e., of all sides together.
+void print_rss_stats(std::ostream& out, rss_sampler& sampler);
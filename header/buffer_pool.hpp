@@ -0,0 +1,76 @@
+/******************************************************************************
+ *                       ____    _    _____                                   *
+ *                      / ___|  / \  |  ___|    C++                           *
+ *                     | |     / _ \ | |_       Actor                         *
+ *                     | |___ / ___ \|  _|      Framework                     *
+ *                      \____/_/   \_|_|                                      *
+ *                                                                            *
+ * Copyright 2011-2020 Jakob Otto                                             *
+ *                                                                            *
+ * Distributed under the terms and conditions of the BSD 3-Clause License or  *
+ * (at your option) under the terms and conditions of the Boost Software      *
+ * License 1.0. See accompanying files LICENSE and LICENSE_ALTERNATIVE.       *
+ *                                                                            *
+ * If you did not receive a copy of the license files, see                    *
+ * http://opensource.org/licenses/BSD-3-Clause and                            *
+ * http://www.boost.org/LICENSE_1_0.txt.                                      *
+ ******************************************************************************/
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+#include "caf/byte.hpp"
+
+/// Recycles byte buffers between all actor systems of this process. Sources
+/// allocate their payloads from the pool and sinks deserialize into pooled
+/// buffers, so a transfer only allocates as many buffers as are in flight.
+///
+/// The pool is a fixed array of slots that are claimed with atomic exchanges,
+/// which keeps it lock-free without suffering from ABA like a linked freelist.
+class buffer_pool {
+public:
+  using buffer_type = std::vector<caf::byte>;
+
+  /// Maximum number of idle buffers kept for reuse.
+  static constexpr size_t capacity = 1024;
+
+  /// Returns the pool shared by all actor systems of this process.
+  static buffer_pool& instance();
+
+  /// Returns an empty buffer, reusing the capacity of a released one if
+  /// possible.
+  std::unique_ptr<buffer_type> acquire();
+
+  /// Stores `buf` for later reuse or frees it if the pool is full. Every
+  /// buffer from `acquire` must come back through this function.
+  void release(std::unique_ptr<buffer_type> buf);
+
+  /// Number of acquired buffers that have not been released yet, i.e., the
+  /// buffers in flight.
+  size_t in_use() const noexcept {
+    return in_use_.load(std::memory_order_relaxed);
+  }
+
+  /// Number of `acquire` calls that reused a buffer.
+  size_t hits() const noexcept {
+    return hits_.load(std::memory_order_relaxed);
+  }
+
+  /// Number of `acquire` calls that allocated a new buffer.
+  size_t misses() const noexcept {
+    return misses_.load(std::memory_order_relaxed);
+  }
+
+private:
+  std::array<std::atomic<buffer_type*>, capacity> slots_{};
+  std::atomic<size_t> idle_{0};
+  std::atomic<size_t> hint_{0};
+  std::atomic<size_t> hits_{0};
+  std::atomic<size_t> misses_{0};
+  std::atomic<size_t> in_use_{0};
+};
@@ -0,0 +1,87 @@
+/******************************************************************************
+ *                       ____    _    _____                                   *
+ *                      / ___|  / \  |  ___|    C++                           *
+ *                     | |     / _ \ | |_       Actor                         *
+ *                     | |___ / ___ \|  _|      Framework                     *
+ *                      \____/_/   \_|_|                                      *
+ *                                                                            *
+ * Copyright 2011-2020 Jakob Otto                                             *
+ *                                                                            *
+ * Distributed under the terms and conditions of the BSD 3-Clause License or  *
+ * (at your option) under the terms and conditions of the Boost Software      *
+ * License 1.0. See accompanying files LICENSE and LICENSE_ALTERNATIVE.       *
+ *                                                                            *
+ * If you did not receive a copy of the license files, see                    *
+ * http://opensource.org/licenses/BSD-3-Clause and                            *
+ * http://www.boost.org/LICENSE_1_0.txt.                                      *
+ ******************************************************************************/
+
+#pragma once
+
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+#include "caf/byte.hpp"
+#include "caf/span.hpp"
+
+/// Refers to a byte buffer that serializes as a length prefix followed by a
+/// single bulk copy of all bytes. Serves as a field inside
+/// `f.object(x).fields(...)`.
+struct bulk_bytes {
+  std::vector<caf::byte>& buf;
+};
+
+template <class Inspector>
+bool inspect(Inspector& f, bulk_bytes& x) {
+  auto size = x.buf.size();
+  if constexpr (Inspector::is_loading) {
+    if (!f.begin_sequence(size))
+      return false;
+    x.buf.resize(size);
+    return f.value(caf::make_span(x.buf)) && f.end_sequence();
+  } else {
+    auto bytes = caf::span<const caf::byte>{x.buf.data(), size};
+    return f.begin_sequence(size) && f.value(bytes) && f.end_sequence();
+  }
+}
+
+/// Byte payload that serializes as a length prefix followed by a single bulk
+/// copy of all bytes. A plain `std::vector<caf::byte>` goes through the
+/// generic list inspection instead, which visits every byte on its own.
+class bulk_payload {
+public:
+  using buffer_type = std::vector<caf::byte>;
+
+  bulk_payload() = default;
+
+  /// Creates a zero-filled payload of `size` bytes.
+  explicit bulk_payload(size_t size) : buf_(size) {
+    // nop
+  }
+
+  explicit bulk_payload(buffer_type buf) : buf_(std::move(buf)) {
+    // nop
+  }
+
+  size_t size() const noexcept {
+    return buf_.size();
+  }
+
+  const caf::byte* data() const noexcept {
+    return buf_.data();
+  }
+
+  buffer_type& buffer() noexcept {
+    return buf_;
+  }
+
+  template <class Inspector>
+  friend bool inspect(Inspector& f, bulk_payload& x) {
+    bulk_bytes bytes{x.buf_};
+    return f.object(x).fields(f.field("bytes", bytes));
+  }
+
+private:
+  buffer_type buf_;
+};
@@ -0,0 +1,105 @@
+/******************************************************************************
+ *                       ____    _    _____                                   *
+ *                      / ___|  / \  |  ___|    C++                           *
+ *                     | |     / _ \ | |_       Actor                         *
+ *                     | |___ / ___ \|  _|      Framework                     *
+ *                      \____/_/   \_|_|                                      *
+ *                                                                            *
+ * Copyright 2011-2020 Jakob Otto                                             *
+ *                                                                            *
+ * Distributed under the terms and conditions of the BSD 3-Clause License or  *
+ * (at your option) under the terms and conditions of the Boost Software      *
+ * License 1.0. See accompanying files LICENSE and LICENSE_ALTERNATIVE.       *
+ *                                                                            *
+ * If you did not receive a copy of the license files, see                    *
+ * http://opensource.org/licenses/BSD-3-Clause and                            *
+ * http://www.boost.org/LICENSE_1_0.txt.                                      *
+ ******************************************************************************/
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "bulk_payload.hpp"
+#include "caf/binary_serializer.hpp"
+#include "caf/byte.hpp"
+#include "caf/byte_buffer.hpp"
+#include "caf/byte_span.hpp"
+#include "caf/detail/serialized_size.hpp"
+#include "caf/sec.hpp"
+#include "caf/serializer.hpp"
+#include "caf/span.hpp"
+#include "compression.hpp"
+
+/// Byte payload that runs through the selected codec whenever it gets
+/// serialized. On the wire, it consists of the original size followed by the
+/// compressed bytes as one bulk copy.
+class compressed_payload {
+public:
+  using buffer_type = std::vector<caf::byte>;
+
+  compressed_payload() = default;
+
+  /// Creates a zero-filled payload of `size` bytes.
+  explicit compressed_payload(size_t size) : buf_(size) {
+    // nop
+  }
+
+  explicit compressed_payload(buffer_type buf) : buf_(std::move(buf)) {
+    // nop
+  }
+
+  size_t size() const noexcept {
+    return buf_.size();
+  }
+
+  const caf::byte* data() const noexcept {
+    return buf_.data();
+  }
+
+  buffer_type& buffer() noexcept {
+    return buf_;
+  }
+
+  /// Whether saving with `Inspector` puts the payload on the wire. Inspectors
+  /// that only compute the size still compress, but do not count towards the
+  /// compression statistics.
+  template <class Inspector>
+  static constexpr bool serializes_v
+    = std::is_same_v<Inspector, caf::binary_serializer>
+      || (std::is_base_of_v<caf::serializer, Inspector>
+          && !std::is_same_v<Inspector,
+                             caf::detail::serialized_size_inspector>);
+
+  template <class Inspector>
+  friend bool inspect(Inspector& f, compressed_payload& x) {
+    // Reuses one scratch buffer per thread for the compressed bytes.
+    thread_local caf::byte_buffer wire;
+    auto original_size = static_cast<uint64_t>(x.buf_.size());
+    bulk_bytes bytes{wire};
+    if constexpr (Inspector::is_loading) {
+      if (!f.object(x).fields(f.field("original_size", original_size),
+                              f.field("bytes", bytes)))
+        return false;
+      x.buf_.resize(original_size);
+      if (!decompress_bytes(caf::const_byte_span{wire.data(), wire.size()},
+                            caf::byte_span{x.buf_.data(), x.buf_.size()})) {
+        f.emplace_error(caf::sec::load_callback_failed);
+        return false;
+      }
+      return true;
+    } else {
+      compress_bytes(caf::const_byte_span{x.buf_.data(), x.buf_.size()}, wire,
+                     serializes_v<Inspector>);
+      return f.object(x).fields(f.field("original_size", original_size),
+                                f.field("bytes", bytes));
+    }
+  }
+
+private:
+  buffer_type buf_;
+};
@@ -0,0 +1,64 @@
+/******************************************************************************
+ *                       ____    _    _____                                   *
+ *                      / ___|  / \  |  ___|    C++                           *
+ *                     | |     / _ \ | |_       Actor                         *
+ *                     | |___ / ___ \|  _|      Framework                     *
+ *                      \____/_/   \_|_|                                      *
+ *                                                                            *
+ * Copyright 2011-2020 Jakob Otto                                             *
+ *                                                                            *
+ * Distributed under the terms and conditions of the BSD 3-Clause License or  *
+ * (at your option) under the terms and conditions of the Boost Software      *
+ * License 1.0. See accompanying files LICENSE and LICENSE_ALTERNATIVE.       *
+ *                                                                            *
+ * If you did not receive a copy of the license files, see                    *
+ * http://opensource.org/licenses/BSD-3-Clause and                            *
+ * http://www.boost.org/LICENSE_1_0.txt.                                      *
+ ******************************************************************************/
+
+#pragma once
+
+#include <iostream>
+#include <string>
+
+#include "caf/byte_buffer.hpp"
+#include "caf/byte_span.hpp"
+
+// The compression stage is off by default. Once a codec is selected, payloads
+// that support it (see compressed_payload.hpp) run through the codec whenever
+// they get serialized. The `none` codec copies the bytes unchanged and serves
+// as the baseline for the overhead of the stage itself.
+
+enum class codec {
+  none,
+  zlib,
+};
+
+/// Returns the name of `x`.
+const char* to_string(codec x);
+
+/// Parses `none` or `zlib` into `x`. Fails for unknown names and for `zlib`
+/// in builds without zlib.
+bool from_string(const std::string& str, codec& x);
+
+/// Enables the compression stage with codec `x` for all payloads in this
+/// process.
+void set_codec(codec x);
+
+/// Returns whether a codec was selected.
+bool compression_enabled();
+
+/// Compresses `in` with the selected codec and stores the result in `out`.
+/// Adds to the statistics only if `count` is true.
+void compress_bytes(caf::const_byte_span in, caf::byte_buffer& out,
+                    bool count = true);
+
+/// Decompresses `in` into `out`, which must have the original size already.
+/// Returns false if the data is corrupt or does not match `out`.
+bool decompress_bytes(caf::const_byte_span in, caf::byte_span out);
+
+/// Prints the statistics of the compression stage in the format
+/// `compression, <codec>, <raw bytes>, <wire bytes>, <ratio>,
+/// <compress cpu us>, <decompress cpu us>, <goodput MiB/s>`. The goodput
+/// spans from the first compression to the last decompression.
+void print_compression_stats(std::ostream& out);
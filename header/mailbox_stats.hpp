@@ -0,0 +1,52 @@
+/******************************************************************************
+ *                       ____    _    _____                                   *
+ *                      / ___|  / \  |  ___|    C++                           *
+ *                     | |     / _ \ | |_       Actor                         *
+ *                     | |___ / ___ \|  _|      Framework                     *
+ *                      \____/_/   \_|_|                                      *
+ *                                                                            *
+ * Copyright 2011-2020 Jakob Otto                                             *
+ *                                                                            *
+ * Distributed under the terms and conditions of the BSD 3-Clause License or  *
+ * (at your option) under the terms and conditions of the Boost Software      *
+ * License 1.0. See accompanying files LICENSE and LICENSE_ALTERNATIVE.       *
+ *                                                                            *
+ * If you did not receive a copy of the license files, see                    *
+ * http://opensource.org/licenses/BSD-3-Clause and                            *
+ * http://www.boost.org/LICENSE_1_0.txt.                                      *
+ ******************************************************************************/
+
+#pragma once
+
+#include <chrono>
+#include <iostream>
+
+#include "caf/fwd.hpp"
+
+// Sampling is off by default. Once enabled, every sampled actor gets a sampler
+// actor that sends it a timestamped probe per interval. The sampler schedules
+// the next probe as soon as it sends the current one, so a flooded mailbox
+// delays the probes but not the sampling interval. When the sampled actor
+// dequeues a probe, it records its mailbox size and the time since the probe
+// was sent, i.e., the queueing delay of a message arriving at that moment.
+
+/// Samples the mailboxes of sink and pong actors every `interval`. A zero
+/// interval disables sampling.
+void set_mailbox_sampling(std::chrono::milliseconds interval);
+
+/// Returns whether mailbox sampling is enabled.
+bool mailbox_sampling_enabled();
+
+/// Spawns a sampler that probes `self` until it terminates if sampling is
+/// enabled.
+void start_mailbox_sampling(caf::event_based_actor* self);
+
+/// Records the sample for a probe that `self` dequeued after the sampler sent
+/// it at time `sent`.
+void record_mailbox_probe(caf::event_based_actor* self, const char* role,
+                          std::chrono::microseconds sent);
+
+/// Prints one line per sample in the format
+/// `mailbox, <role>, <actor id>, <t_ms>, <depth>, <delay_us>`, where `t_ms` is
+/// the time the sample was taken.
+void print_mailbox_stats(std::ostream& out);
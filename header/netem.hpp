@@ -0,0 +1,182 @@
+/******************************************************************************
+ *                       ____    _    _____                                   *
+ *                      / ___|  / \  |  ___|    C++                           *
+ *                     | |     / _ \ | |_       Actor                         *
+ *                     | |___ / ___ \|  _|      Framework                     *
+ *                      \____/_/   \_|_|                                      *
+ *                                                                            *
+ * Copyright 2011-2020 Jakob Otto                                             *
+ *                                                                            *
+ * Distributed under the terms and conditions of the BSD 3-Clause License or  *
+ * (at your option) under the terms and conditions of the Boost Software      *
+ * License 1.0. See accompanying files LICENSE and LICENSE_ALTERNATIVE.       *
+ *                                                                            *
+ * If you did not receive a copy of the license files, see                    *
+ * http://opensource.org/licenses/BSD-3-Clause and                            *
+ * http://www.boost.org/LICENSE_1_0.txt.                                      *
+ ******************************************************************************/
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <random>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "caf/expected.hpp"
+#include "caf/fwd.hpp"
+#include "caf/ip_endpoint.hpp"
+#include "caf/net/stream_socket.hpp"
+#include "caf/net/udp_datagram_socket.hpp"
+
+// -- network emulation --------------------------------------------------------
+
+/// Link properties that apply for `duration` before the next phase starts. A
+/// duration of zero keeps the phase active until the proxy shuts down.
+struct netem_phase {
+  std::chrono::milliseconds duration{0};
+  /// One-way delay added to every chunk or datagram.
+  std::chrono::microseconds latency{0};
+  /// Uniformly distributed variation of `latency` in both directions.
+  std::chrono::microseconds jitter{0};
+  /// Link capacity in bytes per second. Zero disables rate limiting.
+  uint64_t bandwidth = 0;
+  /// Probability of dropping a datagram (UDP only).
+  double loss = 0.0;
+  /// Probability of holding back a datagram for another `latency` so that
+  /// later datagrams overtake it (UDP only).
+  double reorder = 0.0;
+};
+
+/// User-facing configuration of the emulated link, shared by all benchmarks.
+struct netem_config {
+  size_t latency_us = 0;
+  size_t jitter_us = 0;
+  size_t bandwidth = 0;
+  double loss = 0.0;
+  double reorder = 0.0;
+  /// Maximum number of bytes buffered per direction before the proxy stops
+  /// reading, which gives TCP senders proper back pressure.
+  size_t queue_limit = 4 * 1024 * 1024;
+  uint64_t seed = 0;
+  /// Optional file with one phase per line in the format
+  /// `<duration_ms> <latency_us> <jitter_us> <bandwidth> <loss> <reorder>`.
+  std::string schedule_file;
+
+  /// Registers all fields in the category `netem`.
+  void add_options(caf::config_option_set& opts);
+
+  /// Returns whether any emulation is configured.
+  bool enabled() const;
+
+  /// Returns the phases of the emulated link, either from `schedule_file` or a
+  /// single phase built from the flat options.
+  std::vector<netem_phase> schedule() const;
+};
+
+/// Counters collected by a proxy, readable while the proxy is running.
+struct netem_stats {
+  std::atomic<uint64_t> forwarded_bytes{0};
+  std::atomic<uint64_t> forwarded_packets{0};
+  std::atomic<uint64_t> dropped_packets{0};
+  std::atomic<uint64_t> reordered_packets{0};
+  /// Datagrams the proxy could not send on to their receiver.
+  std::atomic<uint64_t> failed_packets{0};
+  /// Time of the first forwarded byte in microseconds since the epoch.
+  std::atomic<int64_t> first_byte_us{0};
+};
+
+/// Relays traffic between two endpoints on a background thread and applies
+/// the configured delay, rate limit, loss and reordering on the way.
+class netem_proxy {
+public:
+  using clock_type = std::chrono::steady_clock;
+
+  explicit netem_proxy(const netem_config& cfg);
+
+  virtual ~netem_proxy();
+
+  /// Stops the relay thread and closes all sockets owned by the proxy.
+  void stop();
+
+  const netem_stats& stats() const {
+    return stats_;
+  }
+
+protected:
+  /// Runs on the relay thread until `stop()` is called or a peer disconnects.
+  virtual void run() = 0;
+
+  void launch();
+
+  const netem_phase& current_phase(clock_type::time_point now) const;
+
+  /// Returns when a packet of `size` bytes entering the link now leaves it.
+  clock_type::time_point departure(clock_type::time_point now,
+                                   clock_type::time_point& link_free,
+                                   size_t size);
+
+  bool roll(double probability);
+
+  void record_forwarded(size_t bytes);
+
+  std::atomic<bool> running_{false};
+  netem_config cfg_;
+  netem_stats stats_;
+
+private:
+  std::vector<netem_phase> phases_;
+  clock_type::time_point start_;
+  std::minstd_rand rng_;
+  std::thread thread_;
+};
+
+/// Emulates a TCP link by relaying between two connected socket pairs.
+class netem_tcp_proxy : public netem_proxy {
+public:
+  using netem_proxy::netem_proxy;
+
+  ~netem_tcp_proxy() override;
+
+  /// Creates the relay and returns the two application-facing sockets.
+  caf::expected<std::pair<caf::net::stream_socket, caf::net::stream_socket>>
+  start();
+
+protected:
+  void run() override;
+
+private:
+  caf::net::stream_socket left_;
+  caf::net::stream_socket right_;
+};
+
+/// Emulates a UDP link by forwarding datagrams to `target`. Datagrams from
+/// `target` go back to the most recent other sender.
+class netem_udp_proxy : public netem_proxy {
+public:
+  using netem_proxy::netem_proxy;
+
+  ~netem_udp_proxy() override;
+
+  /// Binds the relay socket and returns the port peers should send to.
+  caf::expected<uint16_t> start(caf::ip_endpoint target);
+
+protected:
+  void run() override;
+
+private:
+  caf::net::udp_datagram_socket sock_;
+  caf::ip_endpoint target_;
+};
+
+/// Creates a connected socket pair that runs through a `netem_tcp_proxy` if
+/// `cfg` enables any emulation. The proxy is stored in `proxies` and must
+/// outlive both sockets.
+caf::expected<std::pair<caf::net::stream_socket, caf::net::stream_socket>>
+make_connected_tcp_socket_pair(
+  const netem_config& cfg, std::vector<std::unique_ptr<netem_proxy>>& proxies);
@@ -0,0 +1,103 @@
+/******************************************************************************
+ *                       ____    _    _____                                   *
+ *                      / ___|  / \  |  ___|    C++                           *
+ *                     | |     / _ \ | |_       Actor                         *
+ *                     | |___ / ___ \|  _|      Framework                     *
+ *                      \____/_/   \_|_|                                      *
+ *                                                                            *
+ * Copyright 2011-2020 Jakob Otto                                             *
+ *                                                                            *
+ * Distributed under the terms and conditions of the BSD 3-Clause License or  *
+ * (at your option) under the terms and conditions of the Boost Software      *
+ * License 1.0. See accompanying files LICENSE and LICENSE_ALTERNATIVE.       *
+ *                                                                            *
+ * If you did not receive a copy of the license files, see                    *
+ * http://opensource.org/licenses/BSD-3-Clause and                            *
+ * http://www.boost.org/LICENSE_1_0.txt.                                      *
+ ******************************************************************************/
+
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <deque>
+#include <vector>
+
+#include "caf/actor.hpp"
+#include "caf/fwd.hpp"
+#include "payload.hpp"
+
+struct ping_state {
+  size_t count = 0;
+};
+
+/// Answers every pong with the same payload until `num_pings` round trips
+/// completed and reports begin and end to `accumulator`.
+caf::behavior ping_actor(caf::stateful_actor<ping_state>* self,
+                         const caf::actor& accumulator, size_t num_pings,
+                         size_t payload_size);
+
+struct timed_ping_state {
+  size_t count = 0;
+  std::chrono::microseconds begin;
+  std::chrono::steady_clock::time_point last;
+  std::vector<std::chrono::microseconds> rtts;
+};
+
+/// Like `ping_actor`, but stops after exactly `num_pings` round trips, sends
+/// its begin and end timestamps together with the duration of every round
+/// trip to `collector` as `(done_atom, begin, end, rtts)` and quits, which
+/// also takes down the linked pong.
+caf::behavior timed_ping_actor(caf::stateful_actor<timed_ping_state>* self,
+                               const caf::actor& accumulator,
+                               const caf::actor& collector, size_t num_pings,
+                               size_t payload_size);
+
+/// Like `timed_ping_actor`, but sends every ping with `request` to the actor
+/// that sent `init_atom` and continues from the response handler. Aborts the
+/// run if a response takes longer than `timeout`.
+caf::behavior request_ping_actor(caf::stateful_actor<timed_ping_state>* self,
+                                 const caf::actor& accumulator,
+                                 const caf::actor& collector, size_t num_pings,
+                                 size_t payload_size,
+                                 std::chrono::milliseconds timeout);
+
+struct window_ping_state {
+  caf::actor pong;
+  size_t sent = 0;
+  size_t received = 0;
+  std::chrono::microseconds begin;
+  /// Send times of all pings in flight, oldest first.
+  std::deque<std::chrono::steady_clock::time_point> in_flight;
+  std::vector<std::chrono::microseconds> rtts;
+};
+
+/// Keeps up to `window` pings in flight to the actor that sent `init_atom`
+/// until `num_pings` round trips completed and reports like
+/// `timed_ping_actor`. Matches echoes to pings by order, which holds as long
+/// as a single pong answers over a single connection.
+caf::behavior window_ping_actor(caf::stateful_actor<window_ping_state>* self,
+                                const caf::actor& accumulator,
+                                const caf::actor& collector, size_t num_pings,
+                                size_t payload_size, size_t window);
+
+struct dispatcher_state {
+  size_t next = 0;
+};
+
+/// Hands each `init_atom` to the next actor in `pings`, which lets the pong
+/// actors of one node pair up with the ping actors behind a single published
+/// actor. Links to `accumulator`, because the pongs link to the dispatcher and
+/// only shut down once it goes away.
+caf::behavior ping_dispatcher(caf::stateful_actor<dispatcher_state>* self,
+                              const caf::actor& accumulator,
+                              std::vector<caf::actor> pings);
+
+/// Echoes every payload back to `source`.
+caf::behavior pong_actor(caf::event_based_actor* self,
+                         const caf::actor& source);
+
+/// Like `pong_actor`, but answers every ping through a response promise,
+/// the way services answer requests they complete asynchronously.
+caf::behavior promise_pong_actor(caf::event_based_actor* self,
+                                 const caf::actor& source);
@@ -0,0 +1,77 @@
+/******************************************************************************
+ *                       ____    _    _____                                   *
+ *                      / ___|  / \  |  ___|    C++                           *
+ *                     | |     / _ \ | |_       Actor                         *
+ *                     | |___ / ___ \|  _|      Framework                     *
+ *                      \____/_/   \_|_|                                      *
+ *                                                                            *
+ * Copyright 2011-2020 Jakob Otto                                             *
+ *                                                                            *
+ * Distributed under the terms and conditions of the BSD 3-Clause License or  *
+ * (at your option) under the terms and conditions of the Boost Software      *
+ * License 1.0. See accompanying files LICENSE and LICENSE_ALTERNATIVE.       *
+ *                                                                            *
+ * If you did not receive a copy of the license files, see                    *
+ * http://opensource.org/licenses/BSD-3-Clause and                            *
+ * http://www.boost.org/LICENSE_1_0.txt.                                      *
+ ******************************************************************************/
+
+#pragma once
+
+#include <cstddef>
+#include <memory>
+
+#include "buffer_pool.hpp"
+#include "caf/byte.hpp"
+
+/// Payload that takes its storage from the process-wide `buffer_pool` and
+/// returns it on destruction instead of freeing it.
+class pooled_payload {
+public:
+  using buffer_type = buffer_pool::buffer_type;
+
+  pooled_payload() = default;
+
+  /// Creates a zero-filled payload of `size` bytes.
+  explicit pooled_payload(size_t size);
+
+  pooled_payload(const pooled_payload& other);
+
+  pooled_payload(pooled_payload&&) noexcept = default;
+
+  pooled_payload& operator=(const pooled_payload& other);
+
+  pooled_payload& operator=(pooled_payload&&) noexcept = default;
+
+  size_t size() const noexcept {
+    return buf_ ? buf_->size() : 0;
+  }
+
+  const caf::byte* data() const noexcept {
+    return buf_ ? buf_->data() : nullptr;
+  }
+
+  /// Returns the underlying storage, acquiring a buffer from the pool first if
+  /// this payload has none.
+  buffer_type& buffer();
+
+  template <class Inspector>
+  friend bool inspect(Inspector& f, pooled_payload& x) {
+    // Only loading needs storage. Saving an empty payload must not take a
+    // buffer from the pool.
+    if constexpr (Inspector::is_loading) {
+      return f.object(x).fields(f.field("bytes", x.buffer()));
+    } else {
+      buffer_type empty;
+      auto& bytes = x.buf_ ? *x.buf_ : empty;
+      return f.object(x).fields(f.field("bytes", bytes));
+    }
+  }
+
+private:
+  struct releaser {
+    void operator()(buffer_type* ptr) const;
+  };
+
+  std::unique_ptr<buffer_type, releaser> buf_;
+};
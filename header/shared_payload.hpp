@@ -0,0 +1,80 @@
+/******************************************************************************
+ *                       ____    _    _____                                   *
+ *                      / ___|  / \  |  ___|    C++                           *
+ *                     | |     / _ \ | |_       Actor                         *
+ *                     | |___ / ___ \|  _|      Framework                     *
+ *                      \____/_/   \_|_|                                      *
+ *                                                                            *
+ * Copyright 2011-2020 Jakob Otto                                             *
+ *                                                                            *
+ * Distributed under the terms and conditions of the BSD 3-Clause License or  *
+ * (at your option) under the terms and conditions of the Boost Software      *
+ * License 1.0. See accompanying files LICENSE and LICENSE_ALTERNATIVE.       *
+ *                                                                            *
+ * If you did not receive a copy of the license files, see                    *
+ * http://opensource.org/licenses/BSD-3-Clause and                            *
+ * http://www.boost.org/LICENSE_1_0.txt.                                      *
+ ******************************************************************************/
+
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+#include "caf/byte.hpp"
+
+/// Immutable payload that shares its bytes between all copies. Copying only
+/// bumps a reference count, which allows sending the same data many times
+/// without copying it. Writers detach from other owners first.
+class shared_payload {
+public:
+  using buffer_type = std::vector<caf::byte>;
+
+  shared_payload() = default;
+
+  /// Creates a zero-filled payload of `size` bytes.
+  explicit shared_payload(size_t size)
+    : buf_(std::make_shared<buffer_type>(size)) {
+    // nop
+  }
+
+  size_t size() const noexcept {
+    return buf_ ? buf_->size() : 0;
+  }
+
+  const caf::byte* data() const noexcept {
+    return buf_ ? buf_->data() : nullptr;
+  }
+
+  /// Returns how many payloads share the bytes of this one.
+  long use_count() const noexcept {
+    return buf_.use_count();
+  }
+
+  /// Returns writable bytes, copying them first if other payloads share them.
+  buffer_type& unshared() {
+    if (buf_ == nullptr)
+      buf_ = std::make_shared<buffer_type>();
+    else if (buf_.use_count() > 1)
+      buf_ = std::make_shared<buffer_type>(*buf_);
+    return *buf_;
+  }
+
+  template <class Inspector>
+  friend bool inspect(Inspector& f, shared_payload& x) {
+    // Saving reads the shared bytes in place, loading always starts from a
+    // fresh buffer to leave other owners untouched.
+    if constexpr (Inspector::is_loading) {
+      x.buf_ = std::make_shared<buffer_type>();
+      return f.object(x).fields(f.field("bytes", *x.buf_));
+    } else {
+      if (x.buf_ == nullptr)
+        x.buf_ = std::make_shared<buffer_type>();
+      return f.object(x).fields(f.field("bytes", *x.buf_));
+    }
+  }
+
+private:
+  std::shared_ptr<buffer_type> buf_;
+};
@@ -0,0 +1,84 @@
+/******************************************************************************
+ *                       ____    _    _____                                   *
+ *                      / ___|  / \  |  ___|    C++                           *
+ *                     | |     / _ \ | |_       Actor                         *
+ *                     | |___ / ___ \|  _|      Framework                     *
+ *                      \____/_/   \_|_|                                      *
+ *                                                                            *
+ * Copyright 2011-2020 Jakob Otto                                             *
+ *                                                                            *
+ * Distributed under the terms and conditions of the BSD 3-Clause License or  *
+ * (at your option) under the terms and conditions of the Boost Software      *
+ * License 1.0. See accompanying files LICENSE and LICENSE_ALTERNATIVE.       *
+ *                                                                            *
+ * If you did not receive a copy of the license files, see                    *
+ * http://opensource.org/licenses/BSD-3-Clause and                            *
+ * http://www.boost.org/LICENSE_1_0.txt.                                      *
+ ******************************************************************************/
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "caf/actor.hpp"
+#include "caf/fwd.hpp"
+#include "payload.hpp"
+#include "workload.hpp"
+
+// -- flow control -------------------------------------------------------------
+
+/// Credit-based flow control between source and sink. The sink grants
+/// `window` messages or bytes up front and tops up what it consumed whenever
+/// half the window has arrived. A window of zero disables flow control and
+/// the source sends the whole transfer at once.
+struct credit_config {
+  size_t window = 0;
+  bool in_bytes = false;
+};
+
+// -- source actor -------------------------------------------------------------
+
+struct source_state {
+  std::vector<payload> payloads;
+  /// Replaces `payloads` for the structured workload.
+  std::vector<record_batch> records;
+  size_t next = 0;
+  int64_t credit = 0;
+
+  void fill_payloads(size_t byte_amount, size_t message_size);
+
+  bool done() const noexcept {
+    return next >= payloads.size() + records.size();
+  }
+
+  /// Sends the next payload, or the next `batch_size` payloads packed into a
+  /// single `std::vector<payload>`, and returns the number of payload bytes.
+  /// Single payloads go out as `compressed_payload` while compression is
+  /// enabled. Record batches always go out one per message.
+  size_t send_next(caf::event_based_actor* self, const caf::actor& sink,
+                   size_t batch_size);
+};
+
+/// Sends `streaming_amount` bytes in chunks of `message_size` to `sink` after
+/// the sink answered the initial handshake, either at once or within the
+/// credit granted by the sink. A `batch_size` above one packs that many
+/// payloads into each message.
+caf::behavior source_actor(caf::stateful_actor<source_state>* self,
+                           caf::actor sink, size_t streaming_amount,
+                           size_t message_size, size_t batch_size);
+
+// -- sink actor ---------------------------------------------------------------
+
+struct sink_state {
+  caf::actor source;
+  size_t streaming_amount = 0;
+  size_t received_bytes = 0;
+  size_t ticks = 0;
+  size_t consumed = 0;
+};
+
+/// Counts received bytes and reports begin and end to `accumulator`.
+caf::behavior sink_actor(caf::stateful_actor<sink_state>* self,
+                         caf::actor accumulator, credit_config credit);
@@ -24,6 +24,12 @@
 
 #include "caf/fwd.hpp"
 #include "caf/type_id.hpp"
+#include "bulk_payload.hpp"
+#include "compressed_payload.hpp"
+#include "payload.hpp"
+#include "pooled_payload.hpp"
+#include "shared_payload.hpp"
+#include "workload.hpp"
 
 CAF_BEGIN_TYPE_ID_BLOCK(caf_net_benchmark, caf::first_custom_type_id)
 
@@ -31,6 +37,15 @@ CAF_BEGIN_TYPE_ID_BLOCK(caf_net_benchmark, caf::first_custom_type_id)
   CAF_ADD_TYPE_ID(caf_net_benchmark, (caf::stream<caf::byte>) )
   CAF_ADD_TYPE_ID(caf_net_benchmark, (std::vector<std::chrono::microseconds>) )
   CAF_ADD_TYPE_ID(caf_net_benchmark, (std::chrono::microseconds))
+  CAF_ADD_TYPE_ID(caf_net_benchmark, (pooled_payload))
+  CAF_ADD_TYPE_ID(caf_net_benchmark, (shared_payload))
+  CAF_ADD_TYPE_ID(caf_net_benchmark, (std::vector<payload>) )
+  CAF_ADD_TYPE_ID(caf_net_benchmark, (caf::stream<payload>) )
+  CAF_ADD_TYPE_ID(caf_net_benchmark, (bulk_payload))
+  CAF_ADD_TYPE_ID(caf_net_benchmark, (compressed_payload))
+  CAF_ADD_TYPE_ID(caf_net_benchmark, (measurement))
+  CAF_ADD_TYPE_ID(caf_net_benchmark, (record))
+  CAF_ADD_TYPE_ID(caf_net_benchmark, (record_batch))
 
   CAF_ADD_ATOM(caf_net_benchmark, start_atom)
   CAF_ADD_ATOM(caf_net_benchmark, stop_atom)
@@ -43,5 +58,9 @@ CAF_BEGIN_TYPE_ID_BLOCK(caf_net_benchmark, caf::first_custom_type_id)
   CAF_ADD_ATOM(caf_net_benchmark, init_atom)
   CAF_ADD_ATOM(caf_net_benchmark, credit_atom)
   CAF_ADD_ATOM(caf_net_benchmark, quit_atom)
+  CAF_ADD_ATOM(caf_net_benchmark, sample_atom)
+  CAF_ADD_ATOM(caf_net_benchmark, probe_atom)
+  CAF_ADD_ATOM(caf_net_benchmark, retransmit_atom)
+  CAF_ADD_ATOM(caf_net_benchmark, tick_atom)
 
 CAF_END_TYPE_ID_BLOCK(caf_net_benchmark)
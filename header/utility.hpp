@@ -18,6 +18,8 @@
 
 #pragma once
 
+#include <chrono>
+#include <functional>
 #include <iostream>
 #include <string>
 #include <vector>
@@ -72,6 +74,38 @@ void end(Unit begin) {
   std::cout << std::to_string(duration.count()) << ", ";
 }
 
-void exit(const std::string& msg = "", const caf::error& err = caf::none);
+// -- thread configuration -----------------------------------------------------
 
-void exit(const caf::error& err);
+// The benchmarks pin the scheduler to one thread by default. Passing
+// `--caf.scheduler.max-threads` or `--caf.middleman.workers` to a benchmark
+// configures its main actor system, and `share_thread_settings` forwards these
+// values to the actor systems of the remote nodes.
+
+/// Remembers the thread settings of `main_cfg` for the remote nodes. Call this
+/// before launching any node.
+void share_thread_settings(const caf::actor_system_config& main_cfg);
+
+/// Applies the shared thread settings to the config of a remote node.
+void apply_thread_settings(caf::actor_system_config& node_cfg);
+
+// -- failure handling ---------------------------------------------------------
+
+/// Exit code of runs that exceeded their deadline, matching coreutils timeout.
+constexpr int deadline_exit_code = 124;
+
+/// Registers `f` to print the results collected so far if the run aborts.
+void add_partial_result_dumper(std::function<void(std::ostream&)> f);
+
+/// Prints all partial results to `out`.
+void dump_partial_results(std::ostream& out);
+
+/// Aborts the run with `deadline_exit_code` after `timeout`. A timeout of zero
+/// disables the watchdog.
+void start_watchdog(std::chrono::seconds timeout);
+
+/// Prints `msg` and `err`, dumps partial results and terminates the process
+/// without waiting for actor systems that may never shut down.
+[[noreturn]] void exit(const std::string& msg = "",
+                       const caf::error& err = caf::none);
+
+[[noreturn]] void exit(const caf::error& err);
@@ -0,0 +1,138 @@
+/******************************************************************************
+ *                       ____    _    _____                                   *
+ *                      / ___|  / \  |  ___|    C++                           *
+ *                     | |     / _ \ | |_       Actor                         *
+ *                     | |___ / ___ \|  _|      Framework                     *
+ *                      \____/_/   \_|_|                                      *
+ *                                                                            *
+ * Copyright 2011-2020 Jakob Otto                                             *
+ *                                                                            *
+ * Distributed under the terms and conditions of the BSD 3-Clause License or  *
+ * (at your option) under the terms and conditions of the Boost Software      *
+ * License 1.0. See accompanying files LICENSE and LICENSE_ALTERNATIVE.       *
+ *                                                                            *
+ * If you did not receive a copy of the license files, see                    *
+ * http://opensource.org/licenses/BSD-3-Clause and                            *
+ * http://www.boost.org/LICENSE_1_0.txt.                                      *
+ ******************************************************************************/
+
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "caf/byte_span.hpp"
+#include "caf/fwd.hpp"
+#include "payload.hpp"
+
+// -- structured messages ------------------------------------------------------
+
+/// A single reading inside a `record`.
+struct measurement {
+  std::string unit;
+  int64_t timestamp = 0;
+  double value = 0.0;
+};
+
+template <class Inspector>
+bool inspect(Inspector& f, measurement& x) {
+  return f.object(x).fields(f.field("unit", x.unit),
+                            f.field("timestamp", x.timestamp),
+                            f.field("value", x.value));
+}
+
+/// Nested message with strings, a map and a vector of structs, as found in
+/// typical telemetry or RPC traffic.
+struct record {
+  uint64_t id = 0;
+  std::string name;
+  std::map<std::string, std::string> tags;
+  std::vector<measurement> measurements;
+};
+
+template <class Inspector>
+bool inspect(Inspector& f, record& x) {
+  return f.object(x).fields(f.field("id", x.id), f.field("name", x.name),
+                            f.field("tags", x.tags),
+                            f.field("measurements", x.measurements));
+}
+
+/// Records that take the place of a payload of `nominal_size` bytes.
+struct record_batch {
+  uint64_t nominal_size = 0;
+  std::vector<record> records;
+
+  /// Returns the size of the payload this batch replaces, which is what sinks
+  /// count.
+  size_t size() const noexcept {
+    return static_cast<size_t>(nominal_size);
+  }
+};
+
+template <class Inspector>
+bool inspect(Inspector& f, record_batch& x) {
+  return f.object(x).fields(f.field("nominal_size", x.nominal_size),
+                            f.field("records", x.records));
+}
+
+// -- workload selection -------------------------------------------------------
+
+// Payloads are zero-filled by default. Every other workload draws each payload
+// from a fresh generator, seeded with the configured seed and a stream id that
+// the caller picks, e.g., the index of a node or payload. Hence, the data
+// depends only on the seed, the stream and the size, no matter which thread
+// creates it and in which order.
+
+enum class workload {
+  /// Zero-filled bytes.
+  zeros,
+  /// Uniformly distributed random bytes, which do not compress.
+  random,
+  /// Space-separated words from a small vocabulary, which compress well.
+  text,
+  /// `record_batch` messages in benchmarks that support them and serialized
+  /// records as bytes everywhere else.
+  structured,
+};
+
+/// Returns the name of `x`.
+const char* to_string(workload x);
+
+/// Parses `zeros`, `random`, `text` or `structured` into `x`.
+bool from_string(const std::string& str, workload& x);
+
+/// User-facing configuration of the workload, shared by all benchmarks.
+struct workload_config {
+  std::string kind = "zeros";
+  uint64_t seed = 0;
+
+  /// Registers all fields in the category `data`.
+  void add_options(caf::config_option_set& opts);
+
+  /// Selects the configured workload for this process or exits on invalid
+  /// input.
+  void apply() const;
+};
+
+/// Selects the data of all payloads created in this process.
+void set_workload(workload x, uint64_t seed);
+
+/// Returns the selected workload.
+workload current_workload();
+
+/// Fills `buf` with data of the selected workload from `stream`.
+void fill_payload(caf::byte_span buf, uint64_t stream = 0);
+
+/// Returns a payload of `size` bytes with data of the selected workload from
+/// `stream`.
+payload make_payload(size_t size, uint64_t stream = 0);
+
+/// Returns records with a serialized size of at least `size` bytes from
+/// `stream`.
+record_batch make_record_batch(size_t size, uint64_t stream = 0);
+
+/// Returns a message with a record batch for the structured workload and a
+/// payload otherwise, both from `stream`.
+caf::message make_workload_message(size_t size, uint64_t stream = 0);
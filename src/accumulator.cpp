@@ -1,5 +1,9 @@
 #include "accumulator.hpp"
 
+#include <atomic>
+#include <memory>
+
+#include "alloc_stats.hpp"
 #include "caf/behavior.hpp"
 #include "caf/event_based_actor.hpp"
 #include "caf/stateful_actor.hpp"
@@ -11,27 +15,46 @@ caf::behavior accumulator_actor(caf::stateful_actor<accumulator_state>* self,
   using std::chrono::microseconds;
   self->state.begins.reserve(num_nodes);
   self->state.ends.reserve(num_nodes);
+  // Counters are shared with the watchdog, which may run on any thread.
+  struct progress_type {
+    std::atomic<size_t> started{0};
+    std::atomic<size_t> finished{0};
+  };
+  auto progress = std::make_shared<progress_type>();
+  add_partial_result_dumper([progress, num_nodes](std::ostream& out) {
+    out << "PARTIAL: " << progress->started << " of " << num_nodes
+        << " nodes started, " << progress->finished << " finished"
+        << std::endl;
+  });
+  auto finish_node = [=](microseconds end) {
+    auto mean = [=](const auto& x) {
+      auto tmp = std::accumulate(std::next(x.begin()), x.end(), x[0],
+                                 [](const microseconds v1,
+                                    const microseconds v2) -> microseconds {
+                                   return v1 + v2;
+                                 });
+      return tmp / x.size();
+    };
+    ++progress->finished;
+    self->state.ends.emplace_back(end);
+    if (self->state.ends.size() == self->state.ends.capacity()) {
+      mark_alloc_window_end();
+      auto& begins = self->state.begins;
+      auto& ends = self->state.ends;
+      auto duration = mean(ends) - mean(begins);
+      std::cout << duration.count() << ", ";
+      self->quit();
+    }
+  };
   return {
-    [=](init_atom) { self->state.begins.emplace_back(now<microseconds>()); },
-    [=](done_atom) {
-      auto mean = [=](const auto& x) {
-        auto tmp = std::accumulate(std::next(x.begin()), x.end(), x[0],
-                                   [](const microseconds v1,
-                                      const microseconds v2) -> microseconds {
-                                     return v1 + v2;
-                                   });
-        return tmp / x.size();
-      };
-      self->state.ends.emplace_back(now<microseconds>());
-      if (self->state.ends.size() == self->state.ends.capacity()) {
-        auto& begins = self->state.begins;
-        auto& ends = self->state.ends;
-        auto begin = mean(begins);
-        auto end = mean(ends);
-        auto duration = end - begin;
-        std::cout << duration.count() << ", ";
-        self->quit();
-      }
+    [=](init_atom) {
+      ++progress->started;
+      mark_alloc_window_begin();
+      self->state.begins.emplace_back(now<microseconds>());
     },
+    [=](done_atom) { finish_node(now<microseconds>()); },
+    // Lets nodes report when they actually finished, e.g., when they only
+    // notice the end of a stream after a grace period.
+    [=](done_atom, microseconds end) { finish_node(end); },
   };
 }
\ No newline at end of file
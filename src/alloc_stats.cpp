@@ -0,0 +1,341 @@
+#include "alloc_stats.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdlib>
+#include <fstream>
+#include <limits>
+#include <new>
+#include <string>
+
+#include "caf/actor_system_config.hpp"
+#include "caf/thread_hook.hpp"
+
+namespace {
+
+struct side_counters {
+  std::atomic<uint64_t> allocations{0};
+  std::atomic<uint64_t> deallocations{0};
+  std::atomic<uint64_t> bytes{0};
+  std::atomic<uint64_t> live_bytes{0};
+  std::atomic<uint64_t> peak_live_bytes{0};
+};
+
+std::array<side_counters, num_sides> counters;
+
+thread_local size_t current_side = other_side;
+
+std::mutex window_mtx;
+
+bool window_started = false;
+
+std::array<alloc_snapshot, num_sides> window_begin;
+
+std::array<alloc_snapshot, num_sides> window_end;
+
+std::array<alloc_snapshot, num_sides> snapshot_all() {
+  std::array<alloc_snapshot, num_sides> result;
+  for (size_t side = 0; side < num_sides; ++side)
+    result[side] = alloc_stats(side);
+  return result;
+}
+
+class side_hook : public caf::thread_hook {
+public:
+  explicit side_hook(size_t side) : side_(side) {
+    // nop
+  }
+
+  void init(caf::actor_system&) override {
+    // nop
+  }
+
+  void thread_started() override {
+    set_alloc_side(side_);
+  }
+
+  void thread_terminates() override {
+    // nop
+  }
+
+private:
+  size_t side_;
+};
+
+#ifdef CAF_NET_BENCH_ALLOC_STATS
+
+// Messages often die on another side than the one allocating them. Hence,
+// every block starts with a header that remembers the size and the side of
+// the allocation, and frees debit that side instead of the side of the
+// freeing thread. This keeps the live counter of each side exact.
+
+struct alloc_header {
+  uint64_t size;
+  uint64_t side;
+};
+
+/// Space in front of plain allocations, which keeps the alignment of malloc.
+constexpr size_t plain_offset = alignof(std::max_align_t);
+
+static_assert(sizeof(alloc_header) <= plain_offset);
+
+alloc_header* header_of(void* ptr) {
+  return reinterpret_cast<alloc_header*>(ptr) - 1;
+}
+
+void* record_alloc(void* base, size_t offset, size_t size) {
+  auto ptr = static_cast<char*>(base) + offset;
+  auto side = current_side;
+  *header_of(ptr) = alloc_header{size, side};
+  auto& x = counters[side];
+  x.allocations.fetch_add(1, std::memory_order_relaxed);
+  x.bytes.fetch_add(size, std::memory_order_relaxed);
+  auto live = x.live_bytes.fetch_add(size, std::memory_order_relaxed) + size;
+  auto peak = x.peak_live_bytes.load(std::memory_order_relaxed);
+  while (live > peak
+         && !x.peak_live_bytes.compare_exchange_weak(peak, live,
+                                                     std::memory_order_relaxed))
+    ; // nop
+  return ptr;
+}
+
+void* counted_alloc(size_t size) {
+  if (auto base = std::malloc(plain_offset + size))
+    return record_alloc(base, plain_offset, size);
+  return nullptr;
+}
+
+/// Aligned blocks put the header into a full alignment unit in front of the
+/// returned pointer.
+size_t aligned_offset(std::align_val_t align) {
+  return std::max(static_cast<size_t>(align), plain_offset);
+}
+
+void* counted_aligned_alloc(size_t size, std::align_val_t align) {
+  void* base = nullptr;
+  auto offset = aligned_offset(align);
+  if (posix_memalign(&base, offset, offset + size) != 0)
+    return nullptr;
+  return record_alloc(base, offset, size);
+}
+
+void counted_free(void* ptr, size_t offset) {
+  if (ptr == nullptr)
+    return;
+  auto hdr = *header_of(ptr);
+  counters[hdr.side].deallocations.fetch_add(1, std::memory_order_relaxed);
+  counters[hdr.side].live_bytes.fetch_sub(hdr.size, std::memory_order_relaxed);
+  std::free(static_cast<char*>(ptr) - offset);
+}
+
+void counted_free(void* ptr) {
+  counted_free(ptr, plain_offset);
+}
+
+void counted_free(void* ptr, std::align_val_t align) {
+  counted_free(ptr, aligned_offset(align));
+}
+
+#endif // CAF_NET_BENCH_ALLOC_STATS
+
+} // namespace
+
+#ifdef CAF_NET_BENCH_ALLOC_STATS
+
+void* operator new(size_t size) {
+  if (auto ptr = counted_alloc(size))
+    return ptr;
+  throw std::bad_alloc{};
+}
+
+void* operator new[](size_t size) {
+  if (auto ptr = counted_alloc(size))
+    return ptr;
+  throw std::bad_alloc{};
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept {
+  return counted_alloc(size);
+}
+
+void* operator new[](size_t size, const std::nothrow_t&) noexcept {
+  return counted_alloc(size);
+}
+
+void* operator new(size_t size, std::align_val_t align) {
+  if (auto ptr = counted_aligned_alloc(size, align))
+    return ptr;
+  throw std::bad_alloc{};
+}
+
+void* operator new[](size_t size, std::align_val_t align) {
+  if (auto ptr = counted_aligned_alloc(size, align))
+    return ptr;
+  throw std::bad_alloc{};
+}
+
+void operator delete(void* ptr) noexcept {
+  counted_free(ptr);
+}
+
+void operator delete[](void* ptr) noexcept {
+  counted_free(ptr);
+}
+
+void operator delete(void* ptr, size_t) noexcept {
+  counted_free(ptr);
+}
+
+void operator delete[](void* ptr, size_t) noexcept {
+  counted_free(ptr);
+}
+
+void operator delete(void* ptr, std::align_val_t align) noexcept {
+  counted_free(ptr, align);
+}
+
+void operator delete[](void* ptr, std::align_val_t align) noexcept {
+  counted_free(ptr, align);
+}
+
+void operator delete(void* ptr, size_t, std::align_val_t align) noexcept {
+  counted_free(ptr, align);
+}
+
+void operator delete[](void* ptr, size_t, std::align_val_t align) noexcept {
+  counted_free(ptr, align);
+}
+
+#endif // CAF_NET_BENCH_ALLOC_STATS
+
+// -- allocation counting ------------------------------------------------------
+
+bool alloc_stats_enabled() {
+#ifdef CAF_NET_BENCH_ALLOC_STATS
+  return true;
+#else
+  return false;
+#endif
+}
+
+void set_alloc_side(size_t side) {
+  current_side = side < num_sides ? side : other_side;
+}
+
+void tag_threads(caf::actor_system_config& cfg, size_t side) {
+  cfg.add_thread_hook<side_hook>(side);
+}
+
+alloc_snapshot alloc_stats(size_t side) {
+  auto& x = counters[side];
+  alloc_snapshot result;
+  result.allocations = x.allocations.load();
+  result.deallocations = x.deallocations.load();
+  result.bytes = x.bytes.load();
+  result.live_bytes = x.live_bytes.load();
+  result.peak_live_bytes = x.peak_live_bytes.load();
+  return result;
+}
+
+void mark_alloc_window_begin() {
+  std::lock_guard<std::mutex> guard{window_mtx};
+  if (window_started)
+    return;
+  window_started = true;
+  // Restart the peaks so they only cover the window.
+  for (auto& x : counters)
+    x.peak_live_bytes.store(x.live_bytes.load());
+  window_begin = snapshot_all();
+}
+
+void mark_alloc_window_end() {
+  std::lock_guard<std::mutex> guard{window_mtx};
+  window_end = snapshot_all();
+}
+
+void print_alloc_stats(std::ostream& out, size_t num_messages) {
+  static constexpr const char* names[] = {"main", "node", "other"};
+  std::array<alloc_snapshot, num_sides> begin;
+  std::array<alloc_snapshot, num_sides> end;
+  {
+    std::lock_guard<std::mutex> guard{window_mtx};
+    if (window_started) {
+      begin = window_begin;
+      end = window_end;
+    } else {
+      end = snapshot_all();
+    }
+  }
+  auto per_msg = [num_messages](uint64_t value) {
+    return static_cast<double>(value)
+           / static_cast<double>(std::max(num_messages, size_t{1}));
+  };
+  if (!alloc_stats_enabled())
+    out << "alloc: counting disabled, rebuild with CAF_NET_BENCH_ALLOC_STATS"
+        << std::endl;
+  for (size_t side = 0; side < num_sides; ++side) {
+    auto allocations = end[side].allocations - begin[side].allocations;
+    auto bytes = end[side].bytes - begin[side].bytes;
+    out << "alloc, " << names[side] << ", " << allocations << ", " << bytes
+        << ", " << per_msg(allocations) << ", " << per_msg(bytes) << ", "
+        << end[side].peak_live_bytes << std::endl;
+  }
+}
+
+// -- resident set size --------------------------------------------------------
+
+rss_info read_rss() {
+  rss_info result;
+  std::ifstream in{"/proc/self/status"};
+  std::string key;
+  while (in >> key) {
+    if (key == "VmRSS:")
+      in >> result.current_kb;
+    else if (key == "VmHWM:")
+      in >> result.peak_kb;
+    else
+      in.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
+  }
+  return result;
+}
+
+rss_sampler::rss_sampler(std::chrono::milliseconds interval) : running_(true) {
+  thread_ = std::thread{[this, interval] {
+    set_alloc_side(other_side);
+    while (running_) {
+      auto rss = read_rss().current_kb;
+      {
+        std::lock_guard<std::mutex> guard{mtx_};
+        samples_.emplace_back(rss);
+      }
+      std::this_thread::sleep_for(interval);
+    }
+  }};
+}
+
+rss_sampler::~rss_sampler() {
+  stop();
+}
+
+void rss_sampler::stop() {
+  running_ = false;
+  if (thread_.joinable())
+    thread_.join();
+}
+
+size_t rss_sampler::steady_kb() {
+  std::lock_guard<std::mutex> guard{mtx_};
+  if (samples_.empty())
+    return read_rss().current_kb;
+  auto first = samples_.begin() + samples_.size() / 4;
+  auto last = samples_.end() - samples_.size() / 4;
+  std::vector<size_t> xs{first, last};
+  std::nth_element(xs.begin(), xs.begin() + xs.size() / 2, xs.end());
+  return xs[xs.size() / 2];
+}
+
+void print_rss_stats(std::ostream& out, rss_sampler& sampler) {
+  sampler.stop();
+  out << "rss, process, " << sampler.steady_kb() << ", " << read_rss().peak_kb
+      << std::endl;
+}
@@ -0,0 +1,445 @@
+/******************************************************************************
+ *                       ____    _    _____                                   *
+ *                      / ___|  / \  |  ___|    C++                           *
+ *                     | |     / _ \ | |_       Actor                         *
+ *                     | |___ / ___ \|  _|      Framework                     *
+ *                      \____/_/   \_|_|                                      *
+ *                                                                            *
+ * Copyright (C) 2011 - 2020                                                  *
+ * Jakob Otto <jakob.otto (at) haw-hamburg.de>                                *
+ *                                                                            *
+ * Distributed under the terms and conditions of the BSD 3-Clause License or  *
+ * (at your option) under the terms and conditions of the Boost Software      *
+ * License 1.0. See accompanying files LICENSE and LICENCE_ALTERNATIVE.       *
+ *                                                                            *
+ * If you did not receive a copy of the license files, see                    *
+ * http://opensource.org/licenses/BSD-3-Clause and                            *
+ * http://www.boost.org/LICENSE_1_0.txt.                                      *
+ ******************************************************************************/
+
+// Runs the BASP encode -> serialize -> transport -> receive -> deliver path
+// without the TCP/IP stack. The `stages` mode connects two instances of
+// caf-net's `net::basp::application` over an in-memory transport and times
+// each layer. The `netBench` and `ioBench` modes connect two actor systems
+// over an in-memory byte stream (an AF_UNIX stream socket pair, the only
+// transport the multiplexers can poll) and report end-to-end throughput. For
+// streaming over caf-net, `netBench` also prints the per-layer times of the
+// in-memory run and attributes the rest to the multiplexer.
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <thread>
+
+#include "caf/actor_system_config.hpp"
+#include "caf/all.hpp"
+#include "caf/byte_buffer.hpp"
+#include "caf/defaults.hpp"
+#include "caf/io/all.hpp"
+#include "caf/io/network/default_multiplexer.hpp"
+#include "caf/io/network/scribe_impl.hpp"
+#include "caf/io/scribe.hpp"
+#include "caf/mailbox_element.hpp"
+#include "caf/net/backend/tcp.hpp"
+#include "caf/net/basp/application.hpp"
+#include "caf/net/endpoint_manager_queue.hpp"
+#include "caf/net/middleman.hpp"
+#include "caf/net/packet_writer.hpp"
+#include "caf/net/receive_policy.hpp"
+#include "caf/net/stream_socket.hpp"
+#include "caf/proxy_registry.hpp"
+#include "caf/span.hpp"
+#include "caf/uri.hpp"
+#include "pingpong_actors.hpp"
+#include "streaming_actors.hpp"
+#include "type_ids.hpp"
+#include "utility.hpp"
+#include "workload.hpp"
+
+using namespace caf;
+using namespace std::chrono;
+
+namespace {
+
+using clock_type = std::chrono::steady_clock;
+
+/// Number of bytes the emulated transport reads from the stream at once.
+constexpr size_t read_size = 64 * 1024;
+
+struct config : actor_system_config {
+  config() {
+    init_global_meta_objects<caf::id_block::caf_net_benchmark>();
+    io::middleman::init_global_meta_objects();
+    opt_group{custom_options_, "global"}
+      .add(mode, "mode,m", "one of 'stages', 'ioBench', or 'netBench'")
+      .add(workload, "workload,w", "one of 'streaming' or 'pingpong'")
+      .add(streaming_amount, "amount,a", "bytes to stream")
+      .add(num_pings, "pings,p", "number of pings to exchange")
+      .add(message_size, "size,s", "size of the payload in byte")
+      .add(deadline, "deadline", "abort the run after this many seconds");
+    data.add_options(custom_options_);
+
+    earth_id = *make_uri("tcp://earth");
+    put(content, "caf.middleman.this-node", earth_id);
+    put(content, "caf.scheduler.max-threads", 1);
+    load<net::middleman, net::backend::tcp>();
+  }
+
+  size_t message_size = 1024;
+  size_t streaming_amount = 64 * 1024 * 1024;
+  size_t num_pings = 10000;
+  std::string mode = "stages";
+  std::string workload = "streaming";
+  size_t deadline = 0;
+  workload_config data;
+  uri earth_id;
+};
+
+void print_layer(const std::string& name, size_t bytes, nanoseconds duration) {
+  auto secs = duration_cast<std::chrono::duration<double>>(duration).count();
+  auto mib = static_cast<double>(bytes) / (1024.0 * 1024.0);
+  std::cout << name << ", " << duration_cast<microseconds>(duration).count()
+            << ", " << (secs > 0.0 ? mib / secs : 0.0) << std::endl;
+}
+
+template <class F>
+nanoseconds measure(F f) {
+  auto begin = clock_type::now();
+  f();
+  return duration_cast<nanoseconds>(clock_type::now() - begin);
+}
+
+// -- in-process stages --------------------------------------------------------
+
+/// Stands in for the socket and the endpoint manager below a BASP application.
+/// Everything the application writes ends up in `output`, and `read_size`
+/// holds the number of bytes the application asked for with its last call to
+/// `configure_read`.
+class memory_transport : public net::packet_writer,
+                         public net::basp::application::test_tag,
+                         public proxy_registry::backend {
+public:
+  explicit memory_transport(actor_system& sys)
+    : sys_(sys), proxies_(sys, *this), app(proxies_) {
+    // nop
+  }
+
+  actor_system& system() {
+    return sys_;
+  }
+
+  memory_transport& transport() {
+    return *this;
+  }
+
+  net::endpoint_manager& manager() {
+    exit("the in-memory transport has no endpoint manager");
+  }
+
+  buffer_type next_header_buffer() override {
+    return {};
+  }
+
+  buffer_type next_payload_buffer() override {
+    return {};
+  }
+
+  void configure_read(net::receive_policy_config policy) {
+    read_size = policy.second;
+  }
+
+  strong_actor_ptr make_proxy(node_id, actor_id) override {
+    // All messages in this benchmark have an anonymous sender.
+    return nullptr;
+  }
+
+  void set_last_hop(node_id*) override {
+    // nop
+  }
+
+  byte_buffer output;
+
+  size_t read_size = 0;
+
+protected:
+  void write_impl(span<buffer_type*> buffers) override {
+    for (auto buf : buffers)
+      output.insert(output.end(), buf->begin(), buf->end());
+  }
+
+private:
+  actor_system& sys_;
+  proxy_registry proxies_;
+
+public:
+  net::basp::application app;
+};
+
+/// Hands `stream` to the application of `rx` in chunks of `read_size` bytes,
+/// cut along the boundaries the application asks for. Adds the time spent on
+/// copying to `transport` and the time spent in the application to `receive`.
+void feed(memory_transport& rx, const byte_buffer& stream,
+          nanoseconds& transport, nanoseconds& receive) {
+  byte_buffer rd_buf(read_size);
+  byte_buffer pending;
+  for (size_t pos = 0; pos < stream.size();) {
+    auto t0 = clock_type::now();
+    auto chunk = std::min(read_size, stream.size() - pos);
+    std::memcpy(rd_buf.data(), stream.data() + pos, chunk);
+    pos += chunk;
+    auto t1 = clock_type::now();
+    transport += duration_cast<nanoseconds>(t1 - t0);
+    for (size_t offset = 0; offset < chunk;) {
+      auto t2 = clock_type::now();
+      auto take = std::min(rx.read_size - pending.size(), chunk - offset);
+      pending.insert(pending.end(), rd_buf.begin() + offset,
+                     rd_buf.begin() + offset + take);
+      offset += take;
+      auto t3 = clock_type::now();
+      transport += duration_cast<nanoseconds>(t3 - t2);
+      if (pending.size() < rx.read_size)
+        continue;
+      if (auto err = rx.app.handle_data(rx, pending))
+        exit("handle_data failed", err);
+      pending.clear();
+      receive += duration_cast<nanoseconds>(clock_type::now() - t3);
+    }
+  }
+}
+
+/// Time spent in each layer of the caf-net BASP stack.
+struct layer_durations {
+  nanoseconds encode{0};
+  nanoseconds serialize{0};
+  nanoseconds transport{0};
+  nanoseconds receive{0};
+  nanoseconds deliver{0};
+
+  nanoseconds total() const {
+    return encode + serialize + transport + receive + deliver;
+  }
+};
+
+void print_layers(size_t bytes, const layer_durations& xs) {
+  print_layer("encode", bytes, xs.encode);
+  print_layer("serialize", bytes, xs.serialize);
+  print_layer("transport", bytes, xs.transport);
+  print_layer("receive", bytes, xs.receive);
+  print_layer("deliver", bytes, xs.deliver);
+  print_layer("total", bytes, xs.total());
+}
+
+/// Streams `cfg.streaming_amount` bytes from one `net::basp::application` to
+/// another over an in-memory transport and times each layer on the way.
+layer_durations run_stages(actor_system& sys, const config& cfg) {
+  auto num_messages = std::max(cfg.streaming_amount / cfg.message_size,
+                               size_t{1});
+  auto bytes = num_messages * cfg.message_size;
+  layer_durations result;
+  scoped_actor self{sys};
+  auto sink = sys.spawn(sink_actor, actor(self), credit_config{});
+  self->send(sink, init_atom_v, bytes);
+  for (int i = 0; i < 2; ++i)
+    self->receive([](init_atom) {}, [](send_atom) {});
+  // Both applications write their handshake on init. Only the handshake of
+  // the sending side matters, since messages flow in one direction.
+  memory_transport tx{sys};
+  memory_transport rx{sys};
+  if (auto err = tx.app.init(tx))
+    exit("init failed", err);
+  if (auto err = rx.app.init(rx))
+    exit("init failed", err);
+  {
+    nanoseconds ignored{0};
+    feed(rx, tx.output, ignored, ignored);
+    tx.output.clear();
+  }
+  // Encode: wrap payloads into mailbox elements. The data is generated up front
+  // and copied into each message.
+  using queue_message = net::endpoint_manager_queue::message;
+  std::vector<std::unique_ptr<queue_message>> msgs;
+  msgs.reserve(num_messages);
+  auto receiver = actor_cast<strong_actor_ptr>(sink);
+  auto encode_all = [&](const auto& prototype) {
+    return measure([&] {
+      for (size_t i = 0; i < num_messages; ++i)
+        msgs.emplace_back(std::make_unique<queue_message>(
+          make_mailbox_element(nullptr, make_message_id(), {},
+                               make_message(prototype)),
+          receiver));
+    });
+  };
+  result.encode = current_workload() == workload::structured
+                    ? encode_all(make_record_batch(cfg.message_size))
+                    : encode_all(make_payload(cfg.message_size));
+  // Serialize: let the application write BASP headers and payloads.
+  result.serialize = measure([&] {
+    for (auto& msg : msgs)
+      if (auto err = tx.app.write_message(tx, std::move(msg)))
+        exit("write_message failed", err);
+  });
+  msgs.clear();
+  // Transport and receive: the application on the receiving side parses the
+  // headers, deserializes the messages and enqueues them into the sink.
+  feed(rx, tx.output, result.transport, result.receive);
+  tx.output = byte_buffer{};
+  // Deliver: wait until the sink processed everything that is in flight.
+  result.deliver = measure([&] { self->receive([](done_atom) {}); });
+  return result;
+}
+
+// -- end-to-end over an in-memory stream --------------------------------------
+
+void io_run_node(net::stream_socket sock, const config& cfg) {
+  actor_system_config node_cfg;
+  node_cfg.load<io::middleman>();
+  if (auto err = node_cfg.parse(0, nullptr))
+    exit(err);
+  apply_thread_settings(node_cfg);
+  actor_system sys{node_cfg};
+  using io::network::scribe_impl;
+  auto& mm = sys.middleman();
+  auto& mpx = dynamic_cast<io::network::default_multiplexer&>(mm.backend());
+  io::scribe_ptr scribe = make_counted<scribe_impl>(mpx, sock.id);
+  auto bb = mm.named_broker<io::basp_broker>("BASP");
+  scoped_actor self{sys};
+  self->request(bb, infinite, connect_atom_v, std::move(scribe), uint16_t(8080))
+    .receive(
+      [&](node_id&, strong_actor_ptr& ptr, std::set<std::string>&) {
+        if (ptr == nullptr)
+          exit("could not get a handle to the remote actor");
+        if (cfg.workload == "pingpong") {
+          auto pong = sys.spawn(pong_actor, actor_cast<actor>(ptr));
+          anon_send(pong, start_atom_v);
+        } else {
+          auto source = sys.spawn(source_actor, actor_cast<actor>(ptr),
+                                  cfg.streaming_amount, cfg.message_size,
+                                  size_t{1});
+          anon_send(source, init_atom_v);
+        }
+      },
+      [&](error& err) { exit(err); });
+}
+
+void net_run_node(net::stream_socket sock, const config& cfg) {
+  auto this_node = *make_uri("tcp://node");
+  auto locator = *make_uri("tcp://earth/name/target");
+  actor_system_config node_cfg;
+  node_cfg.load<net::middleman, net::backend::tcp>();
+  if (auto err = node_cfg.parse(0, nullptr))
+    exit(err);
+  put(node_cfg.content, "caf.middleman.this-node", this_node);
+  apply_thread_settings(node_cfg);
+  if (auto err = node_cfg.parse(0, nullptr))
+    exit(err);
+  actor_system sys{node_cfg};
+  auto& mm = sys.network_manager();
+  auto& backend = *dynamic_cast<net::backend::tcp*>(mm.backend("tcp"));
+  auto ret = backend.emplace(make_node_id(*locator.authority_only()), sock);
+  if (!ret)
+    exit("emplace failed", ret.error());
+  auto target = mm.remote_actor(locator, 2s);
+  if (!target)
+    exit("remote_actor failed", target.error());
+  if (cfg.workload == "pingpong") {
+    auto pong = sys.spawn(pong_actor, *target);
+    anon_send(pong, start_atom_v);
+  } else {
+    auto source = sys.spawn(source_actor, *target, cfg.streaming_amount,
+                            cfg.message_size, size_t{1});
+    anon_send(source, init_atom_v);
+  }
+}
+
+nanoseconds run_end_to_end(actor_system& sys, const config& cfg) {
+  auto sockets = net::make_stream_socket_pair();
+  if (!sockets)
+    exit("make_stream_socket_pair failed", sockets.error());
+  std::thread node;
+  nanoseconds duration{0};
+  {
+    scoped_actor self{sys};
+    actor target;
+    if (cfg.workload == "pingpong")
+      target = sys.spawn(ping_actor, actor(self), cfg.num_pings,
+                         cfg.message_size);
+    else
+      target = sys.spawn(sink_actor, actor(self), credit_config{});
+    switch (convert(cfg.mode)) {
+      case bench_mode::io: {
+        using io::network::scribe_impl;
+        auto& mm = sys.middleman();
+        auto& mpx
+          = dynamic_cast<io::network::default_multiplexer&>(mm.backend());
+        auto bb = mm.named_broker<io::basp_broker>("BASP");
+        io::scribe_ptr scribe = make_counted<scribe_impl>(mpx,
+                                                          sockets->first.id);
+        anon_send(bb, publish_atom_v, std::move(scribe), uint16_t(8080),
+                  actor_cast<strong_actor_ptr>(target),
+                  std::set<std::string>{});
+        node = std::thread{[&] { io_run_node(sockets->second, cfg); }};
+        break;
+      }
+      case bench_mode::net: {
+        auto& mm = sys.network_manager();
+        auto& backend = *dynamic_cast<net::backend::tcp*>(mm.backend("tcp"));
+        sys.registry().put(std::string("target"), target);
+        auto entry = backend.emplace(make_node_id(*make_uri("tcp://node")),
+                                     sockets->first);
+        if (!entry)
+          exit("emplace failed", entry.error());
+        node = std::thread{[&] { net_run_node(sockets->second, cfg); }};
+        break;
+      }
+      default:
+        exit(std::string("invalid mode: \"") + cfg.mode + "\"");
+    }
+    self->receive([](init_atom) {});
+    auto begin = clock_type::now();
+    self->receive([](done_atom) {});
+    duration = duration_cast<nanoseconds>(clock_type::now() - begin);
+    // Leaving the scope terminates the linked target and with it the remote
+    // node.
+  }
+  node.join();
+  return duration;
+}
+
+void caf_main(actor_system& sys, const config& cfg) {
+  start_watchdog(std::chrono::seconds(cfg.deadline));
+  share_thread_settings(cfg);
+  cfg.data.apply();
+  if (cfg.message_size == 0)
+    exit("message size must be greater than zero");
+  std::cout << "layer, duration_us, mib_s" << std::endl;
+  auto bytes = std::max(cfg.streaming_amount / cfg.message_size, size_t{1})
+               * cfg.message_size;
+  if (cfg.mode == "stages") {
+    print_layers(bytes, run_stages(sys, cfg));
+    return;
+  }
+  if (cfg.workload == "pingpong") {
+    print_layer("end-to-end", 2 * cfg.num_pings * cfg.message_size,
+                run_end_to_end(sys, cfg));
+    return;
+  }
+  // For caf-net, the in-memory run breaks the end-to-end time down by layer.
+  // The remainder is the time spent in the multiplexer, the socket and
+  // waiting for credit.
+  if (convert(cfg.mode) == bench_mode::net) {
+    auto layers = run_stages(sys, cfg);
+    auto duration = run_end_to_end(sys, cfg);
+    print_layers(bytes, layers);
+    print_layer("multiplexer", bytes,
+                std::max(duration - layers.total(), nanoseconds{0}));
+    print_layer("end-to-end", cfg.streaming_amount, duration);
+    return;
+  }
+  std::cerr << "no per-layer breakdown for the io middleman" << std::endl;
+  print_layer("end-to-end", cfg.streaming_amount, run_end_to_end(sys, cfg));
+}
+
+} // namespace
+
+CAF_MAIN(io::middleman)
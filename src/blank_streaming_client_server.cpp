@@ -17,6 +17,7 @@
  * http://www.boost.org/LICENSE_1_0.txt.                                      *
  ******************************************************************************/
 
+#include <algorithm>
 #include <chrono>
 #include <functional>
 #include <iostream>
@@ -25,6 +26,7 @@
 
 #include "caf/actor_system_config.hpp"
 #include "caf/all.hpp"
+#include "caf/byte_span.hpp"
 #include "caf/defaults.hpp"
 #include "caf/io/all.hpp"
 #include "caf/io/network/default_multiplexer.hpp"
@@ -38,45 +40,78 @@
 #include "caf/net/stream_socket.hpp"
 #include "caf/net/tcp_stream_socket.hpp"
 #include "caf/uri.hpp"
+#include "bulk_payload.hpp"
+#include "payload.hpp"
+#include "pooled_payload.hpp"
+#include "shared_payload.hpp"
 #include "type_ids.hpp"
 #include "utility.hpp"
+#include "workload.hpp"
 
 using namespace caf;
 using namespace std::chrono;
 
 namespace {
 
-using payload = std::vector<caf::byte>;
-
 // -- source actor -------------------------------------------------------------
 
+/// Returns the writable bytes of `p`.
+byte_span writable_bytes(payload& p) {
+  return make_span(p);
+}
+
+byte_span writable_bytes(pooled_payload& p) {
+  return make_span(p.buffer());
+}
+
+byte_span writable_bytes(shared_payload& p) {
+  return make_span(p.unshared());
+}
+
+byte_span writable_bytes(bulk_payload& p) {
+  return make_span(p.buffer());
+}
+
+template <class Payload>
 struct source_state {
-  payload p;
+  Payload p;
   std::chrono::system_clock::time_point begin;
+  microseconds send_loop{0};
   size_t streaming_amount = 0;
 };
 
-behavior source_actor(stateful_actor<source_state>* self, actor sink,
+/// Sends the same payload until `streaming_amount` bytes are out. Each send
+/// copies the bytes (`payload`), copies them into a recycled buffer
+/// (`pooled_payload`), only bumps a reference count (`shared_payload`) or
+/// copies the bytes but serializes them in bulk (`bulk_payload`).
+template <class Payload>
+behavior source_actor(stateful_actor<source_state<Payload>>* self, actor sink,
                       size_t payload_size, size_t streaming_amount) {
   return {
     [=](init_atom init) {
       self->state.streaming_amount = streaming_amount;
-      self->state.p.resize(payload_size);
+      self->state.p = Payload(payload_size);
+      fill_payload(writable_bytes(self->state.p));
       self->state.begin = std::chrono::system_clock::now();
       self->send(sink, init, self, streaming_amount);
       self->send(self, send_atom_v);
     },
     [=](send_atom) {
+      auto begin = std::chrono::system_clock::now();
       while (self->state.streaming_amount > 0) {
         self->send(sink, self->state.p);
-        self->state.streaming_amount -= payload_size;
+        self->state.streaming_amount
+          -= std::min(self->state.streaming_amount, payload_size);
       }
+      auto end = std::chrono::system_clock::now();
+      self->state.send_loop = duration_cast<microseconds>(end - begin);
     },
     [=](done_atom) {
       auto end = std::chrono::system_clock::now();
       auto begin = self->state.begin;
       auto duration = end - begin;
       std::cerr << duration_cast<microseconds>(duration).count() << "us "
+                << "(send loop " << self->state.send_loop.count() << "us)"
                 << std::endl;
       self->quit();
     },
@@ -97,17 +132,21 @@ struct sink_state {
 
 behavior sink_actor(stateful_actor<sink_state>* self) {
   self->set_exit_handler([=](const exit_msg&) { self->quit(); });
+  auto received = [=](size_t bytes) {
+    self->state.received_bytes += bytes;
+    if (self->state.received_bytes >= self->state.streaming_amount)
+      self->send(self->state.source, done_atom_v);
+  };
   return {
     [=](init_atom, const actor& source, size_t streaming_amount) {
       self->link_to(source);
       self->state.source = source;
       self->state.streaming_amount = streaming_amount;
     },
-    [=](const payload& p) {
-      self->state.received_bytes += p.size();
-      if (self->state.received_bytes >= self->state.streaming_amount)
-        self->send(self->state.source, done_atom_v);
-    },
+    [=](const payload& p) { received(p.size()); },
+    [=](const pooled_payload& p) { received(p.size()); },
+    [=](const shared_payload& p) { received(p.size()); },
+    [=](const bulk_payload& p) { received(p.size()); },
   };
 }
 
@@ -123,7 +162,12 @@ struct config : actor_system_config {
       .add(streaming_amount, "amount,a", "amount of bytes to transmit")
       .add(is_server, "server,S", "toggle server mode")
       .add(host, "host,H", "host to connect to")
-      .add(port, "port,p", "port to connect to");
+      .add(port, "port,p", "port to connect to")
+      .add(payload_mode, "payload,P",
+           "one of 'copy' (default), 'pooled', 'shared' (copy-on-write) "
+           "or 'bulk'")
+      .add(deadline, "deadline", "abort the run after this many seconds");
+    data.add_options(custom_options_);
 
     earth_id = *make_uri("tcp://earth");
     put(content, "caf.middleman.this-node", earth_id);
@@ -137,10 +181,30 @@ struct config : actor_system_config {
 
   size_t streaming_amount = 1024;
   size_t payload_size = 1;
+  std::string payload_mode = "copy";
   std::string mode = "netBench";
+  size_t deadline = 0;
+  workload_config data;
   uri earth_id;
 };
 
+/// Spawns the source for the payload type selected by `cfg.payload_mode`.
+actor spawn_source(actor_system& sys, const config& cfg, actor sink) {
+  if (cfg.payload_mode == "copy")
+    return sys.spawn(source_actor<payload>, std::move(sink), cfg.payload_size,
+                     cfg.streaming_amount);
+  if (cfg.payload_mode == "pooled")
+    return sys.spawn(source_actor<pooled_payload>, std::move(sink),
+                     cfg.payload_size, cfg.streaming_amount);
+  if (cfg.payload_mode == "shared")
+    return sys.spawn(source_actor<shared_payload>, std::move(sink),
+                     cfg.payload_size, cfg.streaming_amount);
+  if (cfg.payload_mode == "bulk")
+    return sys.spawn(source_actor<bulk_payload>, std::move(sink),
+                     cfg.payload_size, cfg.streaming_amount);
+  exit("invalid payload mode: " + cfg.payload_mode);
+}
+
 // -- IO client and server
 // -----------------------------------------------------
 
@@ -174,7 +238,7 @@ void run_io_client(actor_system&, const config& args) {
   cfg.load<middleman>();
   if (auto err = cfg.parse(0, nullptr))
     exit("parsing config failed", err);
-  put(cfg.content, "caf.scheduler.max-threads", 1);
+  apply_thread_settings(cfg);
   actor_system sys{cfg};
   using network::scribe_impl;
   auto& mm = sys.middleman();
@@ -187,8 +251,7 @@ void run_io_client(actor_system&, const config& args) {
       [&](node_id&, strong_actor_ptr& ptr, std::set<std::string>&) {
         if (ptr == nullptr)
           exit("ERROR: could not get a handle to remote source");
-        auto source = sys.spawn(source_actor, actor_cast<actor>(ptr),
-                                args.payload_size, args.streaming_amount);
+        auto source = spawn_source(sys, args, actor_cast<actor>(ptr));
         anon_send(source, init_atom_v);
       },
       [&](error& err) { exit(err); });
@@ -227,7 +290,7 @@ void run_net_client(actor_system&, const config& args) {
   if (auto err = cfg.parse(0, nullptr))
     exit(err);
   put(cfg.content, "caf.middleman.this-node", source_id);
-  put(cfg.content, "caf.scheduler.max-threads", 1);
+  apply_thread_settings(cfg);
   if (auto err = cfg.parse(0, nullptr))
     exit(err);
   actor_system sys{cfg};
@@ -241,12 +304,14 @@ void run_net_client(actor_system&, const config& args) {
   if (!sink)
     exit("remote actor failed: ", sink.error());
   scoped_actor self{sys};
-  auto source = sys.spawn(source_actor, *sink, args.payload_size,
-                          args.streaming_amount);
+  auto source = spawn_source(sys, args, *sink);
   anon_send(source, init_atom_v);
 }
 
 void caf_main(actor_system& sys, const config& cfg) {
+  start_watchdog(std::chrono::seconds(cfg.deadline));
+  share_thread_settings(cfg);
+  cfg.data.apply();
   using key_type = std::pair<bench_mode, bool>;
   using function_type = std::function<void(actor_system&, const config&)>;
   std::map<key_type, function_type> functions{
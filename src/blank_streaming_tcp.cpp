@@ -17,12 +17,16 @@
  * http://www.boost.org/LICENSE_1_0.txt.                                      *
  ******************************************************************************/
 
+#include <algorithm>
 #include <chrono>
 #include <iostream>
+#include <memory>
 #include <numeric>
 #include <queue>
+#include <string>
 
 #include "accumulator.hpp"
+#include "alloc_stats.hpp"
 #include "caf/actor_system_config.hpp"
 #include "caf/all.hpp"
 #include "caf/defaults.hpp"
@@ -35,75 +39,19 @@
 #include "caf/net/middleman.hpp"
 #include "caf/net/stream_socket.hpp"
 #include "caf/uri.hpp"
+#include "compression.hpp"
+#include "mailbox_stats.hpp"
+#include "netem.hpp"
+#include "streaming_actors.hpp"
 #include "type_ids.hpp"
 #include "utility.hpp"
+#include "workload.hpp"
 
 using namespace caf;
 using namespace std::chrono;
 
 namespace {
 
-using payload = std::vector<caf::byte>;
-
-// -- source actor -------------------------------------------------------------
-
-struct source_state {
-  std::vector<payload> payloads;
-
-  void fill_payloads(size_t byte_amount, size_t message_size) {
-    size_t allocated = 0;
-    while (byte_amount > 0) {
-      auto size = std::min(byte_amount, message_size);
-      allocated += size;
-      payloads.emplace_back(payload(size));
-      byte_amount -= size;
-    }
-  }
-};
-
-behavior source_actor(stateful_actor<source_state>* self, actor sink,
-                      size_t streaming_amount, size_t message_size) {
-  self->set_exit_handler([=](const exit_msg&) { self->quit(); });
-  self->link_to(sink);
-  return {
-    [=](init_atom init) {
-      self->state.fill_payloads(streaming_amount, message_size);
-      self->send(sink, init, streaming_amount);
-    },
-    [=](send_atom) {
-      auto& payloads = self->state.payloads;
-      for (size_t i = 0; i < payloads.size(); ++i)
-        self->send(sink, std::move(payloads[i]));
-    },
-  };
-} // namespace
-
-// -- sink actor ---------------------------------------------------------------
-
-struct sink_state {
-  actor source;
-  size_t streaming_amount = 0;
-  size_t received_bytes = 0;
-  size_t ticks = 0;
-};
-
-behavior sink_actor(stateful_actor<sink_state>* self, actor accumulator) {
-  self->set_exit_handler([=](const exit_msg&) { self->quit(); });
-  self->link_to(accumulator);
-  return {
-    [=](init_atom, size_t streaming_amount) {
-      self->state.streaming_amount = streaming_amount;
-      self->send(accumulator, init_atom_v);
-      return send_atom_v;
-    },
-    [=](const payload& p) {
-      self->state.received_bytes += p.size();
-      if (self->state.received_bytes >= self->state.streaming_amount)
-        self->send(accumulator, done_atom_v);
-    },
-  };
-}
-
 struct config : actor_system_config {
   config() {
     init_global_meta_objects<caf::id_block::caf_net_benchmark>();
@@ -113,7 +61,24 @@ struct config : actor_system_config {
       .add(num_remote_nodes, "num-nodes,n", "number of remote nodes")
       .add(streaming_amount, "amount,a",
            "amount of bytes that should be transmitted")
-      .add(message_size, "size,s", "size of the payload in byte");
+      .add(message_size, "size,s", "size of the payload in byte")
+      .add(deadline, "deadline", "abort the run after this many seconds")
+      .add(alloc_stats, "alloc-stats",
+           "print allocations per message and RSS to stderr")
+      .add(credit.window, "credit",
+           "credit window of the sink, 0 disables flow control")
+      .add(credit.in_bytes, "credit-bytes",
+           "count the credit window in bytes instead of messages")
+      .add(batch_size, "batch,b", "number of payloads packed into a message")
+      .add(mailbox_sampling, "mailbox-sampling",
+           "sample mailbox depth and queueing delay every N ms")
+      .add(compression, "compression",
+           "compress payloads with 'none' (baseline) or 'zlib'")
+      .add(duplex, "duplex",
+           "stream in both directions over each connection at once");
+    netem.add_options(custom_options_);
+    data.add_options(custom_options_);
+    tag_threads(*this, main_side);
 
     earth_id = *make_uri("tcp://earth");
     put(content, "caf.middleman.this-node", earth_id);
@@ -125,16 +90,106 @@ struct config : actor_system_config {
   size_t num_remote_nodes = 1;
   size_t streaming_amount = 1024;
   std::string mode = "netBench";
+  size_t deadline = 0;
+  workload_config data;
+  bool alloc_stats = false;
+  credit_config credit;
+  size_t batch_size = 1;
+  size_t mailbox_sampling = 0;
+  std::string compression;
+  bool duplex = false;
+  netem_config netem;
   uri earth_id;
 };
 
+// -- full-duplex streaming ----------------------------------------------------
+
+// In duplex mode, every connection carries two transfers at once. The main
+// system publishes a peer actor per connection instead of its sink. The remote
+// node asks the peer for the sink on the main side and hands over a sink of its
+// own, which the peer then streams to.
+
+struct direction_state {
+  microseconds first_begin = microseconds::max();
+  microseconds last_end = microseconds::min();
+  size_t finished = 0;
+};
+
+/// Takes the place of the accumulator for all sinks of one direction. Forwards
+/// begin and end to `accumulator` and prints the throughput of the direction
+/// once all `num_sinks` sinks are done.
+behavior direction_actor(stateful_actor<direction_state>* self,
+                         std::string name, actor accumulator,
+                         size_t num_sinks, size_t bytes_per_sink) {
+  return {
+    [=](init_atom x) {
+      auto& st = self->state;
+      st.first_begin = std::min(st.first_begin, now<microseconds>());
+      self->send(accumulator, x);
+    },
+    [=](done_atom x) {
+      auto& st = self->state;
+      st.last_end = now<microseconds>();
+      self->send(accumulator, x);
+      if (++st.finished < num_sinks)
+        return;
+      auto elapsed = st.last_end - st.first_begin;
+      auto mib = static_cast<double>(num_sinks * bytes_per_sink)
+                 / (1024.0 * 1024.0);
+      std::cerr << "direction, " << name << ", " << elapsed.count() << ", "
+                << mib / duration_cast<duration<double>>(elapsed).count()
+                << std::endl;
+      self->quit();
+    },
+  };
+}
+
+/// Connects both directions of one connection on the main side. Replies to
+/// the remote node with the local sink and the accumulator for its sink, then
+/// streams to the sink of the remote node.
+behavior peer_actor(event_based_actor* self, actor sink,
+                    actor reverse_accumulator, size_t streaming_amount,
+                    size_t message_size, size_t batch_size) {
+  return {
+    [=](get_atom) { return make_message(sink, reverse_accumulator); },
+    [=](start_atom, actor reverse_sink) {
+      auto source = self->spawn(source_actor, reverse_sink, streaming_amount,
+                                message_size, batch_size);
+      self->send(source, init_atom_v);
+      self->quit();
+    },
+  };
+}
+
+/// Starts both directions on a remote node after resolving `peer`.
+void run_duplex_node(actor_system& sys, const actor& peer,
+                     size_t streaming_amount, size_t message_size,
+                     size_t batch_size, credit_config credit) {
+  scoped_actor self{sys};
+  self->request(peer, infinite, get_atom_v)
+    .receive(
+      [&](actor& sink, actor& reverse_accumulator) {
+        auto reverse_sink = sys.spawn(sink_actor, reverse_accumulator, credit);
+        auto source = sys.spawn(source_actor, sink, streaming_amount,
+                                message_size, batch_size);
+        anon_send(peer, start_atom_v, reverse_sink);
+        anon_send(source, init_atom_v);
+      },
+      [&](error& err) { exit(err); });
+}
+
+// -- remote nodes -------------------------------------------------------------
+
 void io_run_source(net::stream_socket sock, uint16_t port,
-                   size_t streaming_amount, size_t message_size) {
+                   size_t streaming_amount, size_t message_size,
+                   size_t batch_size, credit_config credit, bool duplex) {
+  set_alloc_side(node_side);
   actor_system_config cfg;
+  tag_threads(cfg, node_side);
   cfg.load<io::middleman>();
   if (auto err = cfg.parse(0, nullptr))
     exit(err);
-  put(cfg.content, "caf.scheduler.max-threads", 1);
+  apply_thread_settings(cfg);
   actor_system sys{cfg};
   using io::network::scribe_impl;
   auto& mm = sys.middleman();
@@ -142,29 +197,40 @@ void io_run_source(net::stream_socket sock, uint16_t port,
   io::scribe_ptr scribe = make_counted<scribe_impl>(mpx, sock.id);
   auto bb = mm.named_broker<io::basp_broker>("BASP");
   scoped_actor self{sys};
+  actor remote;
   self->request(bb, infinite, connect_atom_v, std::move(scribe), port)
     .receive(
       [&](node_id&, strong_actor_ptr& ptr, std::set<std::string>&) {
         if (ptr == nullptr)
           exit("ERROR: could not get a handle to remote source");
-        auto source = sys.spawn(source_actor, actor_cast<actor>(ptr),
-                                streaming_amount, message_size);
-        anon_send(source, init_atom_v);
+        remote = actor_cast<actor>(ptr);
       },
       [&](error& err) { exit(err); });
+  if (duplex) {
+    run_duplex_node(sys, remote, streaming_amount, message_size, batch_size,
+                    credit);
+    return;
+  }
+  auto source = sys.spawn(source_actor, remote, streaming_amount,
+                          message_size, batch_size);
+  anon_send(source, init_atom_v);
 }
 
 void net_run_source(net::stream_socket sock, size_t id, size_t streaming_amount,
-                    size_t message_size) {
+                    size_t message_size, size_t batch_size,
+                    credit_config credit, bool duplex) {
   auto source_id = *make_uri(std::string("tcp://source") + std::to_string(id));
-  auto sink_locator
-    = *make_uri(std::string("tcp://earth/name/sink") + std::to_string(id));
+  auto sink_locator = *make_uri(std::string("tcp://earth/name/")
+                                + (duplex ? "peer" : "sink")
+                                + std::to_string(id));
+  set_alloc_side(node_side);
   actor_system_config cfg;
+  tag_threads(cfg, node_side);
   cfg.load<net::middleman, net::backend::tcp>();
   if (auto err = cfg.parse(0, nullptr))
     exit(err);
   put(cfg.content, "caf.middleman.this-node", source_id);
-  put(cfg.content, "caf.scheduler.max-threads", 1);
+  apply_thread_settings(cfg);
   if (auto err = cfg.parse(0, nullptr))
     exit(err);
   actor_system sys{cfg};
@@ -178,14 +244,54 @@ void net_run_source(net::stream_socket sock, size_t id, size_t streaming_amount,
   auto sink = mm.remote_actor(sink_locator, 2s);
   if (!sink)
     exit(sink.error());
-  scoped_actor self{sys};
-  auto source = sys.spawn(source_actor, *sink, streaming_amount, message_size);
+  if (duplex) {
+    run_duplex_node(sys, *sink, streaming_amount, message_size, batch_size,
+                    credit);
+    return;
+  }
+  auto source = sys.spawn(source_actor, *sink, streaming_amount, message_size,
+                          batch_size);
   anon_send(source, init_atom_v);
 }
 
 void caf_main(actor_system& sys, const config& cfg) {
+  start_watchdog(std::chrono::seconds(cfg.deadline));
+  share_thread_settings(cfg);
+  cfg.data.apply();
+  set_mailbox_sampling(milliseconds(cfg.mailbox_sampling));
+  if (!cfg.compression.empty()) {
+    codec x;
+    if (!from_string(cfg.compression, x))
+      exit("unsupported compression: " + cfg.compression);
+    if (cfg.batch_size > 1)
+      exit("compression requires a batch size of 1");
+    if (current_workload() == workload::structured)
+      exit("compression requires a byte workload");
+    set_codec(x);
+  }
+  set_alloc_side(main_side);
+  auto rss = cfg.alloc_stats ? std::make_unique<rss_sampler>() : nullptr;
+  std::vector<std::unique_ptr<netem_proxy>> proxies;
   std::vector<std::thread> threads;
-  auto accumulator = sys.spawn(accumulator_actor, cfg.num_remote_nodes);
+  auto num_transfers = cfg.num_remote_nodes * (cfg.duplex ? 2 : 1);
+  auto accumulator = sys.spawn(accumulator_actor, num_transfers);
+  // Without duplex, the sinks report straight to the accumulator.
+  auto up = accumulator;
+  auto down = accumulator;
+  if (cfg.duplex) {
+    up = sys.spawn(direction_actor, std::string("up"), accumulator,
+                   cfg.num_remote_nodes, cfg.streaming_amount);
+    down = sys.spawn(direction_actor, std::string("down"), accumulator,
+                     cfg.num_remote_nodes, cfg.streaming_amount);
+  }
+  // Returns the actor a remote node resolves: either `sink` or a peer that
+  // also streams to the node.
+  auto entry_point = [&](const actor& sink) {
+    if (!cfg.duplex)
+      return sink;
+    return sys.spawn(peer_actor, sink, down, cfg.streaming_amount,
+                     cfg.message_size, cfg.batch_size);
+  };
   switch (convert(cfg.mode)) {
     case bench_mode::io: {
       std::cerr << "run in 'ioBench' mode" << std::endl;
@@ -194,13 +300,17 @@ void caf_main(actor_system& sys, const config& cfg) {
       auto& mpx = dynamic_cast<io::network::default_multiplexer&>(mm.backend());
       auto bb = mm.named_broker<io::basp_broker>("BASP");
       for (size_t port = 0; port < cfg.num_remote_nodes; ++port) {
-        auto p = *net::make_stream_socket_pair();
+        auto p = cfg.netem.enabled()
+                   ? *make_connected_tcp_socket_pair(cfg.netem, proxies)
+                   : *net::make_stream_socket_pair();
         io::scribe_ptr scribe = make_counted<scribe_impl>(mpx, p.first.id);
-        auto sink = sys.spawn(sink_actor, accumulator);
+        auto sink = sys.spawn(sink_actor, up, cfg.credit);
         anon_send(bb, publish_atom_v, std::move(scribe), uint16_t(8080 + port),
-                  actor_cast<strong_actor_ptr>(sink), std::set<std::string>{});
+                  actor_cast<strong_actor_ptr>(entry_point(sink)),
+                  std::set<std::string>{});
         auto f = [=, &cfg]() {
-          io_run_source(p.second, port, cfg.streaming_amount, cfg.message_size);
+          io_run_source(p.second, port, cfg.streaming_amount, cfg.message_size,
+                        cfg.batch_size, cfg.credit, cfg.duplex);
         };
         threads.emplace_back(f);
       }
@@ -213,13 +323,16 @@ void caf_main(actor_system& sys, const config& cfg) {
       for (size_t node = 0; node < cfg.num_remote_nodes; ++node) {
         auto source_id
           = *make_uri(std::string("tcp://source") + std::to_string(node));
-        auto sink = sys.spawn(sink_actor, accumulator);
-        sys.registry().put(std::string("sink") + std::to_string(node), sink);
-        auto sockets = *make_connected_tcp_socket_pair();
+        auto sink = sys.spawn(sink_actor, up, cfg.credit);
+        sys.registry().put(std::string(cfg.duplex ? "peer" : "sink")
+                             + std::to_string(node),
+                           entry_point(sink));
+        auto sockets = *make_connected_tcp_socket_pair(cfg.netem, proxies);
         backend.emplace(make_node_id(source_id), sockets.first);
         auto f = [=, &cfg]() {
           net_run_source(sockets.second, node, cfg.streaming_amount,
-                         cfg.message_size);
+                         cfg.message_size, cfg.batch_size, cfg.credit,
+                         cfg.duplex);
         };
         threads.emplace_back(f);
       }
@@ -231,6 +344,16 @@ void caf_main(actor_system& sys, const config& cfg) {
 
   for (auto& t : threads)
     t.join();
+  if (rss) {
+    auto per_node = (cfg.streaming_amount + cfg.message_size - 1)
+                    / cfg.message_size;
+    print_alloc_stats(std::cerr, num_transfers * per_node);
+    print_rss_stats(std::cerr, *rss);
+  }
+  if (mailbox_sampling_enabled())
+    print_mailbox_stats(std::cerr);
+  if (compression_enabled())
+    print_compression_stats(std::cerr);
 }
 
 } // namespace
@@ -17,12 +17,16 @@
  * http://www.boost.org/LICENSE_1_0.txt.                                      *
  ******************************************************************************/
 
+#include <algorithm>
 #include <chrono>
 #include <functional>
 #include <iostream>
+#include <memory>
 #include <thread>
+#include <vector>
 
 #include "accumulator.hpp"
+#include "alloc_stats.hpp"
 #include "caf/actor_system_config.hpp"
 #include "caf/all.hpp"
 #include "caf/byte.hpp"
@@ -36,72 +40,194 @@
 #include "caf/net/socket_guard.hpp"
 #include "caf/net/udp_datagram_socket.hpp"
 #include "caf/uri.hpp"
+#include "netem.hpp"
+#include "pooled_payload.hpp"
 #include "type_ids.hpp"
 #include "utility.hpp"
+#include "workload.hpp"
 
 using namespace caf;
 using namespace std::chrono;
 
 namespace {
 
-using payload = std::vector<caf::byte>;
-
 // -- source actor -------------------------------------------------------------
 
 struct source_state {
-  std::vector<payload> payloads;
-
-  void fill_payloads(size_t byte_amount, size_t message_size) {
-    size_t allocated = 0;
-    while (byte_amount > 0) {
-      auto size = std::min(byte_amount, message_size);
-      allocated += size;
-      payloads.emplace_back(payload(size));
-      byte_amount -= size;
-    }
-  }
+  payload prototype;
+  size_t sent_bytes = 0;
+  steady_clock::time_point begin;
 };
 
+/// Upper bound for pooled buffers in flight in this process. Unpaced sources
+/// pause while the sinks and the transport hold this many buffers, which
+/// bounds the pool by the in-flight window instead of the whole transfer.
+constexpr size_t max_buffers_in_flight = buffer_pool::capacity;
+
+/// Sends `streaming_amount` bytes in datagrams of `message_size` bytes to
+/// `sink`, paced to `rate` bytes per second unless `rate` is zero, and marks
+/// the end of the stream with a `done_atom`.
 behavior source_actor(stateful_actor<source_state>* self, actor sink,
-                      size_t streaming_amount, size_t message_size) {
+                      size_t streaming_amount, size_t message_size,
+                      size_t rate) {
   self->set_exit_handler([=](const exit_msg&) { self->quit(); });
   self->link_to(sink);
   return {
-    [=](init_atom init) {
-      self->state.fill_payloads(streaming_amount, message_size);
-      self->send(sink, init, streaming_amount);
-    },
+    [=](init_atom init) { self->send(sink, init, streaming_amount); },
     [=](send_atom) {
-      auto& payloads = self->state.payloads;
-      for (size_t i = 0; i < payloads.size(); ++i)
-        self->send(sink, std::move(payloads[i]));
+      auto& st = self->state;
+      if (st.prototype.empty()) {
+        st.prototype = make_payload(message_size);
+        st.begin = steady_clock::now();
+      }
+      auto due = streaming_amount;
+      if (rate > 0) {
+        auto elapsed = duration_cast<duration<double>>(steady_clock::now()
+                                                       - st.begin);
+        auto budget = static_cast<size_t>(elapsed.count()
+                                          * static_cast<double>(rate));
+        due = std::min(due, budget + message_size);
+      }
+      // Buffers return to the pool once the message has been serialized, so
+      // the source waits for free slots instead of queueing the whole
+      // transfer at once.
+      auto& pool = buffer_pool::instance();
+      auto copy_data = current_workload() != workload::zeros;
+      while (st.sent_bytes < due && pool.in_use() < max_buffers_in_flight) {
+        auto size = std::min(streaming_amount - st.sent_bytes, message_size);
+        pooled_payload p(size);
+        if (copy_data)
+          std::copy_n(st.prototype.begin(), size, p.buffer().begin());
+        self->send(sink, std::move(p));
+        st.sent_bytes += size;
+      }
+      if (st.sent_bytes >= streaming_amount)
+        self->send(sink, done_atom_v);
+      else if (st.sent_bytes < due) // Waits for buffers to return.
+        self->delayed_send(self, 100us, send_atom_v);
+      else
+        self->delayed_send(self, 1ms, send_atom_v);
     },
   };
 }
 
 // -- sink actor ---------------------------------------------------------------
 
+// Datagrams may get lost, including the end-of-stream marker. Hence, the sink
+// only counts what arrives and stops either after receiving everything, one
+// slice after the marker once nothing arrived in between (datagrams may
+// overtake the marker), or after nothing arrived for `idle_timeout` at all.
+
+struct sink_settings {
+  milliseconds slice{100};
+  milliseconds idle_timeout{1000};
+};
+
+/// Bytes received in one time slice. The last slice usually ends early.
+struct rate_sample {
+  size_t bytes;
+  steady_clock::duration elapsed;
+};
+
 struct sink_state {
-  actor source;
   size_t streaming_amount = 0;
   size_t received_bytes = 0;
-  size_t ticks = 0;
+  size_t received_messages = 0;
+  size_t slice_bytes = 0;
+  bool end_of_stream = false;
+  bool finished = false;
+  steady_clock::time_point started;
+  steady_clock::time_point first;
+  steady_clock::time_point last;
+  steady_clock::time_point slice_begin;
+  /// Receive rate per time slice, starting with the handshake.
+  std::vector<rate_sample> slices;
 };
 
-behavior sink_actor(stateful_actor<sink_state>* self, actor accumulator) {
+using sink_actor_type = stateful_actor<sink_state>;
+
+double mib_per_second(size_t bytes, steady_clock::duration elapsed) {
+  auto seconds = duration_cast<duration<double>>(elapsed).count();
+  if (seconds <= 0.0)
+    return 0.0;
+  return static_cast<double>(bytes) / (1024.0 * 1024.0) / seconds;
+}
+
+void close_slice(sink_state& st, steady_clock::time_point now) {
+  st.slices.push_back(rate_sample{st.slice_bytes, now - st.slice_begin});
+  st.slice_bytes = 0;
+  st.slice_begin = now;
+}
+
+void finish(sink_actor_type* self, const actor& accumulator,
+            const char* reason) {
+  auto& st = self->state;
+  auto stop = steady_clock::now();
+  st.finished = true;
+  close_slice(st, stop);
+  steady_clock::duration t{0};
+  for (auto& sample : st.slices) {
+    std::cerr << "udp_rate, " << self->id() << ", "
+              << duration_cast<milliseconds>(t).count() << ", "
+              << mib_per_second(sample.bytes, sample.elapsed) << std::endl;
+    t += sample.elapsed;
+  }
+  auto delivered = static_cast<double>(st.received_bytes)
+                   / static_cast<double>(std::max(st.streaming_amount,
+                                                  size_t{1}));
+  std::cerr << "udp_stream, " << self->id() << ", " << st.streaming_amount
+            << ", " << st.received_bytes << ", " << st.received_messages
+            << ", " << delivered << ", "
+            << mib_per_second(st.received_bytes, st.last - st.first) << ", "
+            << reason << std::endl;
+  // The stream ended with the last datagram, not when the sink noticed.
+  auto end = now<microseconds>();
+  if (st.received_messages > 0)
+    end -= duration_cast<microseconds>(stop - st.last);
+  self->send(accumulator, done_atom_v, end);
+}
+
+behavior sink_actor(sink_actor_type* self, actor accumulator,
+                    sink_settings cfg) {
   self->set_exit_handler([=](const exit_msg&) { self->quit(); });
   self->link_to(accumulator);
   return {
     [=](init_atom, size_t streaming_amount) {
-      self->state.streaming_amount = streaming_amount;
+      auto& st = self->state;
+      st.streaming_amount = streaming_amount;
+      st.started = steady_clock::now();
+      st.slice_begin = st.started;
       self->send(accumulator, init_atom_v);
+      self->delayed_send(self, cfg.slice, tick_atom_v);
       return send_atom_v;
     },
-    [=](const payload& p) {
-      self->state.received_bytes += p.size();
-      std::cout << "got " << self->state.received_bytes << std::endl;
-      if (self->state.received_bytes >= self->state.streaming_amount)
-        self->send(accumulator, done_atom_v);
+    [=](const pooled_payload& p) {
+      auto& st = self->state;
+      if (st.finished)
+        return;
+      st.last = steady_clock::now();
+      if (st.received_messages++ == 0)
+        st.first = st.last;
+      st.received_bytes += p.size();
+      st.slice_bytes += p.size();
+      if (st.received_bytes >= st.streaming_amount)
+        finish(self, accumulator, "complete");
+    },
+    [=](done_atom) { self->state.end_of_stream = true; },
+    [=](tick_atom) {
+      auto& st = self->state;
+      if (st.finished)
+        return;
+      auto now = steady_clock::now();
+      auto active = st.received_messages > 0 ? st.last : st.started;
+      if (st.end_of_stream && now - active >= cfg.slice) {
+        finish(self, accumulator, "end_of_stream");
+      } else if (now - active >= cfg.idle_timeout) {
+        finish(self, accumulator, "timeout");
+      } else {
+        close_slice(st, now);
+        self->delayed_send(self, cfg.slice, tick_atom_v);
+      }
     },
   };
 }
@@ -114,7 +240,17 @@ struct config : actor_system_config {
       .add(num_remote_nodes, "num-nodes,n", "number of remote nodes")
       .add(streaming_amount, "amount,a",
            "amount of bytes that should be transmitted")
-      .add(message_size, "size,s", "size of the payload in byte");
+      .add(message_size, "size,s", "size of the payload in byte")
+      .add(rate, "rate,r", "send rate per node in bytes/s, 0 = unpaced")
+      .add(slice, "slice", "length of a receive rate sample in ms")
+      .add(idle_timeout, "idle-timeout",
+           "end the stream after receiving nothing for this many ms")
+      .add(deadline, "deadline", "abort the run after this many seconds")
+      .add(alloc_stats, "alloc-stats",
+           "print allocations per message and RSS to stderr");
+    netem.add_options(custom_options_);
+    data.add_options(custom_options_);
+    tag_threads(*this, main_side);
     put(content, "caf.middleman.this-node", this_node);
     put(content, "caf.scheduler.max-threads", 1);
     load<net::middleman, net::backend::udp>();
@@ -123,22 +259,33 @@ struct config : actor_system_config {
   size_t message_size = 1;
   size_t num_remote_nodes = 1;
   size_t streaming_amount = 1024;
+  size_t rate = 0;
+  size_t slice = 100;
+  size_t idle_timeout = 1000;
+  size_t deadline = 0;
+  workload_config data;
+  bool alloc_stats = false;
+  netem_config netem;
   uri this_node;
 };
 
 void net_run_source_node(uri this_node, const std::string& remote_str,
+                         const std::string& sink_name,
                          net::udp_datagram_socket sock, uint16_t port,
-                         size_t streaming_amount, size_t message_size) {
+                         size_t streaming_amount, size_t message_size,
+                         size_t rate) {
   std::cerr << "net_run_source_node thread started! " << std::endl;
   std::cerr << "thread got socket " << sock.id << std::endl;
+  set_alloc_side(node_side);
   actor_system_config cfg;
+  tag_threads(cfg, node_side);
   cfg.load<net::middleman, net::backend::udp>();
   net::middleman::init_global_meta_objects();
   init_global_meta_objects<caf::id_block::caf_net_benchmark>();
   if (auto err = cfg.parse(0, nullptr))
     exit("thread could not parse config 1: ", err);
   put(cfg.content, "caf.middleman.this-node", this_node);
-  put(cfg.content, "caf.scheduler.max-threads", 1);
+  apply_thread_settings(cfg);
   std::cerr << "pong_node " << to_string(this_node) << std::endl;
   if (auto err = cfg.parse(0, nullptr))
     exit("thread could not parse config 2: ", err);
@@ -150,17 +297,23 @@ void net_run_source_node(uri this_node, const std::string& remote_str,
   auto ret = backend.emplace(sock, port);
   if (!ret)
     exit("thread backend.emplace failed: ", ret.error());
-  auto remote_locator = make_uri(remote_str + "/name/sink");
+  auto remote_locator = make_uri(remote_str + "/name/" + sink_name);
   if (!remote_locator)
     exit("thread make_uri failed: ", remote_locator.error());
   auto sink = mm.remote_actor(*remote_locator, 2s);
   if (!sink)
     exit("thread remote actor failed: ", sink.error());
-  auto source = sys.spawn(source_actor, *sink, streaming_amount, message_size);
+  auto source = sys.spawn(source_actor, *sink, streaming_amount, message_size,
+                          rate);
   anon_send(source, init_atom_v);
 }
 
 void caf_main(actor_system&, const config& args) {
+  start_watchdog(std::chrono::seconds(args.deadline));
+  share_thread_settings(args);
+  args.data.apply();
+  set_alloc_side(main_side);
+  auto rss = args.alloc_stats ? std::make_unique<rss_sampler>() : nullptr;
   ip_endpoint ep;
   auto addrs = net::ip::local_addresses("localhost");
   if (addrs.empty())
@@ -179,10 +332,12 @@ void caf_main(actor_system&, const config& args) {
     exit("main make_uri failed", this_node.error());
   std::cerr << "main ping_node = " << to_string(this_node) << std::endl;
   actor_system_config cfg;
+  tag_threads(cfg, main_side);
   cfg.load<net::middleman, net::backend::udp>();
   if (auto err = cfg.parse(0, nullptr))
     exit("main, could not parse config 1", err);
   put(cfg.content, "caf.middleman.this-node", *this_node);
+  apply_thread_settings(cfg);
   if (auto err = cfg.parse(0, nullptr))
     exit("main, could not parse config 2", err);
   actor_system sys{cfg};
@@ -194,10 +349,18 @@ void caf_main(actor_system&, const config& args) {
   if (!err)
     exit("main backend.emplace() failed: ", err.error());
   auto accumulator = sys.spawn(accumulator_actor, args.num_remote_nodes);
-  auto sink = sys.spawn(sink_actor, accumulator);
-  mm.publish(sink, "sink");
+  sink_settings settings;
+  settings.slice = milliseconds(std::max(args.slice, size_t{1}));
+  settings.idle_timeout = milliseconds(args.idle_timeout);
+  // Each remote node streams to its own sink, which keeps the accounting per
+  // stream.
+  for (size_t i = 0; i < args.num_remote_nodes; ++i)
+    mm.publish(sys.spawn(sink_actor, accumulator, settings),
+               "sink" + std::to_string(i));
   std::this_thread::sleep_for(500ms);
   std::vector<std::thread> threads;
+  std::vector<std::unique_ptr<netem_proxy>> proxies;
+  ip_endpoint this_ep{addrs.front(), port};
   std::cerr << "starting remote node now!" << std::endl;
   std::vector<net::socket_guard<net::udp_datagram_socket>> sockets;
   for (size_t i = 0; i < args.num_remote_nodes; ++i) {
@@ -215,15 +378,38 @@ void caf_main(actor_system&, const config& args) {
     std::cerr << "ping_id = " << to_string(*this_node)
               << " pong_id = " << to_string(*pong_id) << std::endl;
     std::cerr << "main passing to thread socket " << sock.id << std::endl;
-    auto f = [pong_id = *pong_id, this_node_str, sock = sock, port = port,
-              &args]() {
-      net_run_source_node(pong_id, this_node_str, sock, port,
-                          args.streaming_amount, args.message_size);
+    auto remote_str = this_node_str;
+    if (args.netem.enabled()) {
+      // Let the remote node talk to this node through an emulated link.
+      auto proxy = std::make_unique<netem_udp_proxy>(args.netem);
+      auto proxy_port = proxy->start(this_ep);
+      if (!proxy_port)
+        exit("main starting netem proxy failed", proxy_port.error());
+      remote_str = "udp://" + to_string(addrs.front()) + ":"
+                   + std::to_string(*proxy_port);
+      proxies.emplace_back(std::move(proxy));
+    }
+    auto f = [pong_id = *pong_id, remote_str, sock = sock, port = port,
+              sink_name = "sink" + std::to_string(i), &args]() {
+      net_run_source_node(pong_id, remote_str, sink_name, sock, port,
+                          args.streaming_amount, args.message_size, args.rate);
     };
     threads.emplace_back(f);
   }
   for (auto& t : threads)
     t.join();
+  for (auto& proxy : proxies)
+    if (auto failed = proxy->stats().failed_packets.load(); failed > 0)
+      std::cerr << "netem, failed_packets, " << failed << std::endl;
+  auto& pool = buffer_pool::instance();
+  std::cerr << "buffer pool: " << pool.hits() << " hits, " << pool.misses()
+            << " misses" << std::endl;
+  if (rss) {
+    auto per_node = (args.streaming_amount + args.message_size - 1)
+                    / args.message_size;
+    print_alloc_stats(std::cerr, args.num_remote_nodes * per_node);
+    print_rss_stats(std::cerr, *rss);
+  }
   std::cerr << std::endl;
 }
 
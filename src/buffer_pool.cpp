@@ -0,0 +1,49 @@
+#include "buffer_pool.hpp"
+
+buffer_pool& buffer_pool::instance() {
+  static buffer_pool pool;
+  return pool;
+}
+
+std::unique_ptr<buffer_pool::buffer_type> buffer_pool::acquire() {
+  in_use_.fetch_add(1, std::memory_order_relaxed);
+  if (idle_.load(std::memory_order_acquire) > 0) {
+    auto start = hint_.load(std::memory_order_relaxed);
+    for (size_t i = 0; i < capacity; ++i) {
+      auto& slot = slots_[(start + i) % capacity];
+      if (slot.load(std::memory_order_relaxed) == nullptr)
+        continue;
+      if (auto ptr = slot.exchange(nullptr, std::memory_order_acquire)) {
+        idle_.fetch_sub(1, std::memory_order_relaxed);
+        hint_.store((start + i) % capacity, std::memory_order_relaxed);
+        hits_.fetch_add(1, std::memory_order_relaxed);
+        ptr->clear();
+        return std::unique_ptr<buffer_type>{ptr};
+      }
+    }
+  }
+  misses_.fetch_add(1, std::memory_order_relaxed);
+  return std::make_unique<buffer_type>();
+}
+
+void buffer_pool::release(std::unique_ptr<buffer_type> buf) {
+  if (buf == nullptr)
+    return;
+  in_use_.fetch_sub(1, std::memory_order_relaxed);
+  if (buf->capacity() == 0)
+    return;
+  auto start = hint_.load(std::memory_order_relaxed);
+  for (size_t i = 0; i < capacity; ++i) {
+    auto& slot = slots_[(start + i) % capacity];
+    buffer_type* expected = nullptr;
+    if (slot.compare_exchange_strong(expected, buf.get(),
+                                     std::memory_order_release,
+                                     std::memory_order_relaxed)) {
+      buf.release();
+      idle_.fetch_add(1, std::memory_order_release);
+      hint_.store((start + i) % capacity, std::memory_order_relaxed);
+      return;
+    }
+  }
+  // The pool is full, let `buf` free the memory.
+}
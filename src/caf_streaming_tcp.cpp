@@ -17,7 +17,9 @@
  * http://www.boost.org/LICENSE_1_0.txt.                                      *
  ******************************************************************************/
 
+#include <algorithm>
 #include <iostream>
+#include <memory>
 #include <numeric>
 
 #include "accumulator.hpp"
@@ -33,8 +35,11 @@
 #include "caf/net/middleman.hpp"
 #include "caf/net/stream_socket.hpp"
 #include "caf/uri.hpp"
+#include "netem.hpp"
+#include "payload.hpp"
 #include "type_ids.hpp"
 #include "utility.hpp"
+#include "workload.hpp"
 
 using namespace caf;
 using namespace std::chrono;
@@ -43,10 +48,18 @@ namespace {
 
 struct source_state {
   size_t left = 0;
+  /// Generated once and copied into every element.
+  payload prototype;
+  /// Position of the next byte in `prototype` for the byte source.
+  size_t pos = 0;
 };
 
-behavior source_actor(stateful_actor<source_state>* self, actor sink,
-                      size_t streaming_amount) {
+/// Number of generated bytes the byte source cycles through.
+constexpr size_t byte_prototype_size = 4096;
+
+/// Streams `streaming_amount` single-byte elements to `sink`.
+behavior byte_source_actor(stateful_actor<source_state>* self, actor sink,
+                           size_t streaming_amount) {
   self->set_exit_handler([=](const exit_msg&) { self->quit(); });
   self->link_to(sink);
   return {
@@ -54,13 +67,20 @@ behavior source_actor(stateful_actor<source_state>* self, actor sink,
       return attach_stream_source(
         self, sink,
         // initialize state
-        [=](unit_t&) { self->state.left = streaming_amount; },
+        [=](unit_t&) {
+          self->state.left = streaming_amount;
+          self->state.prototype = make_payload(byte_prototype_size);
+        },
         // get next element
         [=](unit_t&, downstream<caf::byte>& out, size_t num) {
-          auto to_send = std::min(self->state.left, num);
-          for (size_t i = 0; i < to_send; ++i)
-            out.push(byte{42});
-          self->state.left -= to_send;
+          auto& st = self->state;
+          auto to_send = std::min(st.left, num);
+          for (size_t i = 0; i < to_send; ++i) {
+            out.push(st.prototype[st.pos]);
+            if (++st.pos == st.prototype.size())
+              st.pos = 0;
+          }
+          st.left -= to_send;
         },
         // check whether we reached the end
         [=](const unit_t&) { return self->state.left <= 0; });
@@ -68,6 +88,46 @@ behavior source_actor(stateful_actor<source_state>* self, actor sink,
   };
 }
 
+/// Streams `streaming_amount` bytes to `sink` in elements of `chunk_size`
+/// bytes, which amortizes the per-element overhead of CAF streams.
+behavior chunk_source_actor(stateful_actor<source_state>* self, actor sink,
+                            size_t streaming_amount, size_t chunk_size) {
+  self->set_exit_handler([=](const exit_msg&) { self->quit(); });
+  self->link_to(sink);
+  return {
+    [=](start_atom) {
+      return attach_stream_source(
+        self, sink,
+        // initialize state
+        [=](unit_t&) {
+          self->state.left = streaming_amount;
+          self->state.prototype = make_payload(chunk_size);
+        },
+        // get next element
+        [=](unit_t&, downstream<payload>& out, size_t num) {
+          auto& st = self->state;
+          for (size_t i = 0; i < num && st.left > 0; ++i) {
+            auto size = std::min(st.left, chunk_size);
+            out.push(payload(st.prototype.begin(),
+                             st.prototype.begin() + size));
+            st.left -= size;
+          }
+        },
+        // check whether we reached the end
+        [=](const unit_t&) { return self->state.left == 0; });
+    },
+  };
+}
+
+/// Spawns the byte or chunk source, depending on `chunk_size`.
+actor spawn_source(actor_system& sys, actor sink, size_t streaming_amount,
+                   size_t chunk_size) {
+  if (chunk_size == 0)
+    return sys.spawn(byte_source_actor, std::move(sink), streaming_amount);
+  return sys.spawn(chunk_source_actor, std::move(sink), streaming_amount,
+                   chunk_size);
+}
+
 struct sink_state {
   size_t received = 0;
   size_t streaming_amount = 0;
@@ -95,6 +155,24 @@ behavior sink_actor(stateful_actor<sink_state>* self, actor accumulator) {
           self->quit();
         });
     },
+    [=](const stream<payload>& in) {
+      self->send(accumulator, init_atom_v);
+      return attach_stream_sink(
+        self,
+        // input stream
+        in,
+        // initialize state
+        [](unit_t&) {
+          // nop
+        },
+        // processing step
+        [=](unit_t&, payload& x) { self->state.received += x.size(); },
+        // cleanup
+        [=](unit_t&) {
+          self->send(accumulator, done_atom_v);
+          self->quit();
+        });
+    },
   };
 }
 
@@ -106,7 +184,12 @@ struct config : actor_system_config {
       .add(mode, "mode,m", "one of 'local', 'ioBench', or 'netBench'")
       .add(num_remote_nodes, "num-nodes,n", "number of remote nodes")
       .add(streaming_amount, "amount,a",
-           "amount of bytes that should be transmitted");
+           "amount of bytes that should be transmitted")
+      .add(chunk_size, "chunk,c",
+           "bytes per stream element, 0 streams single bytes")
+      .add(deadline, "deadline", "abort the run after this many seconds");
+    netem.add_options(custom_options_);
+    data.add_options(custom_options_);
 
     earth_id = *make_uri("tcp://earth");
     put(content, "caf.middleman.this-node", earth_id);
@@ -116,16 +199,23 @@ struct config : actor_system_config {
 
   size_t streaming_amount = 1024;
   size_t num_remote_nodes = 1;
+  size_t chunk_size = 0;
   std::string mode = "netBench";
+  size_t deadline = 0;
+  workload_config data;
+  netem_config netem;
   uri earth_id;
 };
 
 void io_run_source(net::stream_socket sock, uint16_t port,
-                   size_t streaming_amount) {
+                   size_t streaming_amount, size_t chunk_size,
+                   const settings& stream_settings) {
   actor_system_config cfg;
   cfg.load<io::middleman>();
   if (auto err = cfg.parse(0, nullptr))
     exit(err);
+  apply_thread_settings(cfg);
+  put(cfg.content, "caf.stream", stream_settings);
   actor_system sys{cfg};
   using io::network::scribe_impl;
   auto& mm = sys.middleman();
@@ -138,15 +228,16 @@ void io_run_source(net::stream_socket sock, uint16_t port,
       [&](node_id&, strong_actor_ptr& ptr, std::set<std::string>&) {
         if (ptr == nullptr)
           exit("could not get a handle to remote source");
-        auto source = sys.spawn(source_actor, actor_cast<actor>(ptr),
-                                streaming_amount);
+        auto source = spawn_source(sys, actor_cast<actor>(ptr),
+                                   streaming_amount, chunk_size);
         self->send(source, start_atom_v);
       },
       [&](error& err) { exit(err); });
 }
 
 void net_run_source(net::stream_socket sock, size_t id,
-                    size_t streaming_amount) {
+                    size_t streaming_amount, size_t chunk_size,
+                    const settings& stream_settings) {
   auto source_id = *make_uri(std::string("tcp://source") + std::to_string(id));
   auto sink_locator
     = *make_uri(std::string("tcp://earth/name/sink") + std::to_string(id));
@@ -155,7 +246,8 @@ void net_run_source(net::stream_socket sock, size_t id,
   if (auto err = cfg.parse(0, nullptr))
     exit(err);
   put(cfg.content, "caf.middleman.this-node", source_id);
-  put(cfg.content, "caf.scheduler.max-threads", 1);
+  apply_thread_settings(cfg);
+  put(cfg.content, "caf.stream", stream_settings);
   if (auto err = cfg.parse(0, nullptr))
     exit(err);
   actor_system sys{cfg};
@@ -169,13 +261,21 @@ void net_run_source(net::stream_socket sock, size_t id,
   if (!sink)
     exit(sink.error());
   scoped_actor self{sys};
-  auto source = sys.spawn(source_actor, *sink, streaming_amount);
+  auto source = spawn_source(sys, *sink, streaming_amount, chunk_size);
   self->send(source, start_atom_v);
 }
 
 void caf_main(actor_system& sys, const config& cfg) {
+  start_watchdog(std::chrono::seconds(cfg.deadline));
+  share_thread_settings(cfg);
+  cfg.data.apply();
+  std::vector<std::unique_ptr<netem_proxy>> proxies;
   std::vector<std::thread> threads;
   auto accumulator = sys.spawn(accumulator_actor, cfg.num_remote_nodes);
+  // Let the sources batch with the same stream settings as the sinks.
+  settings stream_settings;
+  if (auto ptr = get_if<settings>(&cfg.content, "caf.stream"))
+    stream_settings = *ptr;
   switch (convert(cfg.mode)) {
     case bench_mode::io: {
       std::cerr << "run in 'ioBench' mode" << std::endl;
@@ -184,13 +284,16 @@ void caf_main(actor_system& sys, const config& cfg) {
       auto& mpx = dynamic_cast<io::network::default_multiplexer&>(mm.backend());
       auto bb = mm.named_broker<io::basp_broker>("BASP");
       for (size_t port = 0; port < cfg.num_remote_nodes; ++port) {
-        auto p = *net::make_stream_socket_pair();
+        auto p = cfg.netem.enabled()
+                   ? *make_connected_tcp_socket_pair(cfg.netem, proxies)
+                   : *net::make_stream_socket_pair();
         io::scribe_ptr scribe = make_counted<scribe_impl>(mpx, p.first.id);
         auto sink = sys.spawn(sink_actor, accumulator);
         anon_send(bb, publish_atom_v, std::move(scribe), uint16_t(8080 + port),
                   actor_cast<strong_actor_ptr>(sink), std::set<std::string>{});
         auto f = [=, &cfg]() {
-          io_run_source(p.second, port, cfg.streaming_amount);
+          io_run_source(p.second, port, cfg.streaming_amount, cfg.chunk_size,
+                        stream_settings);
         };
         threads.emplace_back(f);
       }
@@ -205,12 +308,13 @@ void caf_main(actor_system& sys, const config& cfg) {
           = *make_uri(std::string("tcp://source") + std::to_string(node));
         auto sink = sys.spawn(sink_actor, accumulator);
         sys.registry().put(std::string("sink") + std::to_string(node), sink);
-        auto sockets = *make_connected_tcp_socket_pair();
+        auto sockets = *make_connected_tcp_socket_pair(cfg.netem, proxies);
         auto entry = backend.emplace(make_node_id(source_id), sockets.first);
         if (!entry)
           exit("emplace failed", entry.error());
         auto f = [=, &cfg]() {
-          net_run_source(sockets.second, node, cfg.streaming_amount);
+          net_run_source(sockets.second, node, cfg.streaming_amount,
+                         cfg.chunk_size, stream_settings);
         };
         threads.emplace_back(f);
       }
@@ -0,0 +1,165 @@
+#include "compression.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <limits>
+#include <time.h>
+
+#ifdef CAF_NET_BENCH_ZLIB
+#  include <zlib.h>
+#endif
+
+#include "utility.hpp"
+
+using namespace caf;
+using namespace std::chrono;
+
+namespace {
+
+/// Trades compression ratio for speed, which is what a transport would pick.
+constexpr int zlib_level = 1;
+
+std::atomic<bool> enabled{false};
+
+std::atomic<codec> selected{codec::none};
+
+std::atomic<uint64_t> raw_bytes{0};
+
+std::atomic<uint64_t> wire_bytes{0};
+
+std::atomic<uint64_t> compress_ns{0};
+
+std::atomic<uint64_t> decompress_ns{0};
+
+std::atomic<int64_t> first_compress{std::numeric_limits<int64_t>::max()};
+
+std::atomic<int64_t> last_decompress{0};
+
+uint64_t thread_cpu_ns() {
+  timespec ts;
+  clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+  return static_cast<uint64_t>(ts.tv_sec) * 1'000'000'000 + ts.tv_nsec;
+}
+
+int64_t steady_ns() {
+  return duration_cast<nanoseconds>(steady_clock::now().time_since_epoch())
+    .count();
+}
+
+void update_min(std::atomic<int64_t>& x, int64_t value) {
+  auto cur = x.load(std::memory_order_relaxed);
+  while (value < cur
+         && !x.compare_exchange_weak(cur, value, std::memory_order_relaxed))
+    ; // nop
+}
+
+void update_max(std::atomic<int64_t>& x, int64_t value) {
+  auto cur = x.load(std::memory_order_relaxed);
+  while (value > cur
+         && !x.compare_exchange_weak(cur, value, std::memory_order_relaxed))
+    ; // nop
+}
+
+} // namespace
+
+const char* to_string(codec x) {
+  switch (x) {
+    case codec::zlib:
+      return "zlib";
+    default:
+      return "none";
+  }
+}
+
+bool from_string(const std::string& str, codec& x) {
+  if (str == "none") {
+    x = codec::none;
+    return true;
+  }
+#ifdef CAF_NET_BENCH_ZLIB
+  if (str == "zlib") {
+    x = codec::zlib;
+    return true;
+  }
+#endif
+  return false;
+}
+
+void set_codec(codec x) {
+  selected = x;
+  enabled = true;
+}
+
+bool compression_enabled() {
+  return enabled;
+}
+
+void compress_bytes(const_byte_span in, byte_buffer& out, bool count) {
+  if (count)
+    update_min(first_compress, steady_ns());
+  auto cpu_begin = thread_cpu_ns();
+  switch (selected.load(std::memory_order_relaxed)) {
+#ifdef CAF_NET_BENCH_ZLIB
+    case codec::zlib: {
+      auto len = compressBound(static_cast<uLong>(in.size()));
+      out.resize(len);
+      auto dst = reinterpret_cast<Bytef*>(out.data());
+      auto src = reinterpret_cast<const Bytef*>(in.data());
+      if (compress2(dst, &len, src, static_cast<uLong>(in.size()), zlib_level)
+          != Z_OK)
+        exit("zlib failed to compress");
+      out.resize(len);
+      break;
+    }
+#endif
+    default:
+      out.assign(in.begin(), in.end());
+  }
+  if (!count)
+    return;
+  compress_ns.fetch_add(thread_cpu_ns() - cpu_begin,
+                        std::memory_order_relaxed);
+  raw_bytes.fetch_add(in.size(), std::memory_order_relaxed);
+  wire_bytes.fetch_add(out.size(), std::memory_order_relaxed);
+}
+
+bool decompress_bytes(const_byte_span in, byte_span out) {
+  auto cpu_begin = thread_cpu_ns();
+  auto ok = false;
+  switch (selected.load(std::memory_order_relaxed)) {
+#ifdef CAF_NET_BENCH_ZLIB
+    case codec::zlib: {
+      auto len = static_cast<uLongf>(out.size());
+      auto dst = reinterpret_cast<Bytef*>(out.data());
+      auto src = reinterpret_cast<const Bytef*>(in.data());
+      ok = uncompress(dst, &len, src, static_cast<uLong>(in.size())) == Z_OK
+           && len == out.size();
+      break;
+    }
+#endif
+    default:
+      ok = in.size() == out.size();
+      if (ok && !in.empty())
+        memcpy(out.data(), in.data(), in.size());
+  }
+  decompress_ns.fetch_add(thread_cpu_ns() - cpu_begin,
+                          std::memory_order_relaxed);
+  update_max(last_decompress, steady_ns());
+  return ok;
+}
+
+void print_compression_stats(std::ostream& out) {
+  auto raw = raw_bytes.load();
+  auto wire = wire_bytes.load();
+  auto ratio = wire > 0 ? static_cast<double>(raw) / static_cast<double>(wire)
+                        : 0.0;
+  auto span_ns = last_decompress.load() - first_compress.load();
+  auto goodput = span_ns > 0 ? (static_cast<double>(raw) / (1024.0 * 1024.0))
+                                 / (static_cast<double>(span_ns) / 1e9)
+                             : 0.0;
+  out << "compression, " << to_string(selected) << ", " << raw << ", " << wire
+      << ", " << ratio << ", " << compress_ns.load() / 1000 << ", "
+      << decompress_ns.load() / 1000 << ", " << goodput << std::endl;
+}
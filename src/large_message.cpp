@@ -0,0 +1,373 @@
+/******************************************************************************
+ *                       ____    _    _____                                   *
+ *                      / ___|  / \  |  ___|    C++                           *
+ *                     | |     / _ \ | |_       Actor                         *
+ *                     | |___ / ___ \|  _|      Framework                     *
+ *                      \____/_/   \_|_|                                      *
+ *                                                                            *
+ * Copyright (C) 2011 - 2020                                                  *
+ * Jakob Otto <jakob.otto (at) haw-hamburg.de>                                *
+ *                                                                            *
+ * Distributed under the terms and conditions of the BSD 3-Clause License or  *
+ * (at your option) under the terms and conditions of the Boost Software      *
+ * License 1.0. See accompanying files LICENSE and LICENCE_ALTERNATIVE.       *
+ *                                                                            *
+ * If you did not receive a copy of the license files, see                    *
+ * http://opensource.org/licenses/BSD-3-Clause and                            *
+ * http://www.boost.org/LICENSE_1_0.txt.                                      *
+ ******************************************************************************/
+
+// Sends one or a few huge payloads (16 MiB and up) over io, net or a raw TCP
+// socket and measures what a single large message costs each stack:
+//
+// - ttfb_us: time from starting to send until the first byte of the payload
+//   crosses the connection, i.e., mostly the time spent serializing
+// - total_us: time until the receiver holds the complete message
+// - wire_bytes: bytes that crossed the connection during the transfer
+// - sender_peak_bytes / receiver_peak_bytes: growth of the live heap on each
+//   side, taken from `peak_live_bytes` after `mark_alloc_window_begin` reset
+//   it at the start of the transfer. A block counts against the side that
+//   allocated it until it is freed, even if the other side frees it. Requires
+//   a build with CAF_NET_BENCH_ALLOC_STATS
+// - sender_copies / receiver_copies: the peak growth in multiples of the
+//   payload size, i.e., the copies each side allocated and held at once,
+//   including the buffer of the application
+// - rss_growth_kb: growth of the peak RSS (VmHWM) of the whole process
+//
+// All traffic runs through a relay thread (see `netem.hpp`), which counts the
+// bytes on the wire and can emulate a slower link via the `netem` options. The
+// output is one CSV row per run.
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <memory>
+#include <set>
+#include <string>
+#include <thread>
+
+#include "alloc_stats.hpp"
+#include "caf/actor_system_config.hpp"
+#include "caf/all.hpp"
+#include "caf/defaults.hpp"
+#include "caf/io/all.hpp"
+#include "caf/io/network/default_multiplexer.hpp"
+#include "caf/io/network/scribe_impl.hpp"
+#include "caf/io/scribe.hpp"
+#include "caf/net/backend/tcp.hpp"
+#include "caf/net/middleman.hpp"
+#include "caf/net/socket.hpp"
+#include "caf/net/stream_socket.hpp"
+#include "caf/span.hpp"
+#include "caf/uri.hpp"
+#include "netem.hpp"
+#include "type_ids.hpp"
+#include "utility.hpp"
+#include "workload.hpp"
+
+using namespace caf;
+using namespace std::chrono;
+
+namespace {
+
+struct config : actor_system_config {
+  config() {
+    init_global_meta_objects<caf::id_block::caf_net_benchmark>();
+    io::middleman::init_global_meta_objects();
+    opt_group{custom_options_, "global"}
+      .add(mode, "mode,m", "one of 'ioBench', 'netBench' or 'raw'")
+      .add(size, "size,s", "size of each payload in byte")
+      .add(count, "count,c", "number of payloads to send")
+      .add(deadline, "deadline", "abort the run after this many seconds");
+    netem.add_options(custom_options_);
+    data.add_options(custom_options_);
+    tag_threads(*this, main_side);
+    earth_id = *make_uri("tcp://earth");
+    put(content, "caf.middleman.this-node", earth_id);
+    put(content, "caf.scheduler.max-threads", 1);
+    load<net::middleman, net::backend::tcp>();
+  }
+
+  std::string mode = "netBench";
+  size_t size = 64 * 1024 * 1024;
+  size_t count = 1;
+  size_t deadline = 0;
+  workload_config data;
+  netem_config netem;
+  uri earth_id;
+};
+
+// -- transfer timing ----------------------------------------------------------
+
+// Sender, receiver and relay all run in this process, so they share the
+// timestamps of the transfer as plain globals. All timestamps are microseconds
+// since the epoch as returned by `now()`.
+
+netem_proxy* relay = nullptr;
+
+std::atomic<uint64_t> begin_forwarded{0};
+
+std::atomic<int64_t> begin_us{0};
+
+std::atomic<int64_t> first_byte_us{0};
+
+std::atomic<int64_t> end_us{0};
+
+/// Called by the sender once its payload exists and right before it hands the
+/// payload to the transport.
+void mark_begin() {
+  begin_forwarded = relay->stats().forwarded_bytes.load();
+  begin_us = now().count();
+}
+
+/// Called by the receiver once it holds the last payload.
+void mark_end() {
+  end_us = now().count();
+}
+
+/// Polls the relay until the first byte after `mark_begin` crosses it.
+void watch_first_byte() {
+  while (begin_us == 0 && end_us == 0)
+    std::this_thread::sleep_for(50us);
+  while (relay->stats().forwarded_bytes == begin_forwarded && end_us == 0)
+    std::this_thread::sleep_for(50us);
+  first_byte_us = now().count();
+}
+
+// -- actors -------------------------------------------------------------------
+
+/// Sends `count` payloads of `size` bytes to `sink`. All but the last payload
+/// are copies of the first one.
+behavior source_actor(event_based_actor* self, actor sink, size_t size,
+                      size_t count) {
+  self->set_exit_handler([=](const exit_msg&) { self->quit(); });
+  self->link_to(sink);
+  return {
+    [=](start_atom) {
+      auto prototype = make_payload(size);
+      mark_begin();
+      for (size_t i = 1; i < count; ++i)
+        self->send(sink, payload{prototype});
+      self->send(sink, std::move(prototype));
+    },
+  };
+}
+
+struct sink_state {
+  size_t received = 0;
+};
+
+behavior sink_actor(stateful_actor<sink_state>* self, size_t count) {
+  return {
+    [=](const payload&) {
+      if (++self->state.received == count) {
+        mark_end();
+        self->quit();
+      }
+    },
+  };
+}
+
+// -- remote node --------------------------------------------------------------
+
+void io_run_source(net::stream_socket sock, uint16_t port, size_t size,
+                   size_t count) {
+  set_alloc_side(node_side);
+  actor_system_config cfg;
+  tag_threads(cfg, node_side);
+  cfg.load<io::middleman>();
+  if (auto err = cfg.parse(0, nullptr))
+    exit(err);
+  apply_thread_settings(cfg);
+  actor_system sys{cfg};
+  using io::network::scribe_impl;
+  auto& mm = sys.middleman();
+  auto& mpx = dynamic_cast<io::network::default_multiplexer&>(mm.backend());
+  io::scribe_ptr scribe = make_counted<scribe_impl>(mpx, sock.id);
+  auto bb = mm.named_broker<io::basp_broker>("BASP");
+  scoped_actor self{sys};
+  self->request(bb, infinite, connect_atom_v, std::move(scribe), port)
+    .receive(
+      [&](node_id&, strong_actor_ptr& ptr, std::set<std::string>&) {
+        if (ptr == nullptr)
+          exit("could not get a handle to the remote sink");
+        auto source = sys.spawn(source_actor, actor_cast<actor>(ptr), size,
+                                count);
+        anon_send(source, start_atom_v);
+      },
+      [&](error& err) { exit(err); });
+}
+
+void net_run_source(net::stream_socket sock, size_t size, size_t count) {
+  set_alloc_side(node_side);
+  auto sink_locator = *make_uri("tcp://earth/name/sink");
+  actor_system_config cfg;
+  tag_threads(cfg, node_side);
+  cfg.load<net::middleman, net::backend::tcp>();
+  if (auto err = cfg.parse(0, nullptr))
+    exit(err);
+  put(cfg.content, "caf.middleman.this-node", *make_uri("tcp://source"));
+  apply_thread_settings(cfg);
+  if (auto err = cfg.parse(0, nullptr))
+    exit(err);
+  actor_system sys{cfg};
+  auto& mm = sys.network_manager();
+  auto& backend = *dynamic_cast<net::backend::tcp*>(mm.backend("tcp"));
+  auto ret = backend.emplace(make_node_id(*sink_locator.authority_only()),
+                             sock);
+  if (!ret)
+    exit("emplace failed", ret.error());
+  auto sink = mm.remote_actor(sink_locator, 2s);
+  if (!sink)
+    exit(sink.error());
+  auto source = sys.spawn(source_actor, *sink, size, count);
+  anon_send(source, start_atom_v);
+}
+
+// -- raw transfer -------------------------------------------------------------
+
+// The raw mode sends each payload behind a 64-bit length prefix straight from
+// the buffer of the application, which is the lower bound for both stacks.
+
+void write_all(net::stream_socket sock, const_byte_span buf) {
+  while (!buf.empty()) {
+    auto ret = net::write(sock, buf);
+    if (ret > 0)
+      buf = buf.subspan(static_cast<size_t>(ret));
+    else if (ret == 0 || !net::last_socket_error_is_temporary())
+      exit("write failed");
+  }
+}
+
+void read_all(net::stream_socket sock, byte_span buf) {
+  while (!buf.empty()) {
+    auto ret = net::read(sock, buf);
+    if (ret > 0)
+      buf = buf.subspan(static_cast<size_t>(ret));
+    else if (ret == 0 || !net::last_socket_error_is_temporary())
+      exit("read failed");
+  }
+}
+
+void raw_send(net::stream_socket sock, size_t size, size_t count) {
+  set_alloc_side(node_side);
+  auto buf = make_payload(size);
+  uint64_t header = size;
+  mark_begin();
+  for (size_t i = 0; i < count; ++i) {
+    write_all(sock, as_bytes(make_span(&header, 1)));
+    write_all(sock, make_span(buf));
+  }
+}
+
+void raw_receive(net::stream_socket sock, size_t count) {
+  set_alloc_side(main_side);
+  for (size_t i = 0; i < count; ++i) {
+    uint64_t header = 0;
+    read_all(sock, as_writable_bytes(make_span(&header, 1)));
+    payload buf(header);
+    read_all(sock, make_span(buf));
+  }
+  mark_end();
+}
+
+// -- reporting ----------------------------------------------------------------
+
+uint64_t peak_growth(const alloc_snapshot& baseline, size_t side) {
+  auto peak = alloc_stats(side).peak_live_bytes;
+  return peak > baseline.live_bytes ? peak - baseline.live_bytes : 0;
+}
+
+double copies(uint64_t bytes, size_t size) {
+  return static_cast<double>(bytes) / static_cast<double>(size);
+}
+
+void caf_main(actor_system& sys, const config& cfg) {
+  start_watchdog(std::chrono::seconds(cfg.deadline));
+  share_thread_settings(cfg);
+  cfg.data.apply();
+  set_alloc_side(main_side);
+  if (cfg.size == 0 || cfg.count == 0)
+    exit("size and count must be positive");
+  if (!alloc_stats_enabled())
+    std::cerr << "alloc: counting disabled, rebuild with "
+                 "CAF_NET_BENCH_ALLOC_STATS"
+              << std::endl;
+  auto proxy = std::make_unique<netem_tcp_proxy>(cfg.netem);
+  auto p = proxy->start();
+  if (!p)
+    exit("could not start the relay", p.error());
+  relay = proxy.get();
+  // Restarts the peak live bytes of every side, so the peaks below only
+  // cover this transfer.
+  mark_alloc_window_begin();
+  std::array<alloc_snapshot, num_sides> baseline;
+  for (size_t side = 0; side < num_sides; ++side)
+    baseline[side] = alloc_stats(side);
+  auto rss_before = read_rss().peak_kb;
+  std::thread watcher{watch_first_byte};
+  std::thread node;
+  if (cfg.mode == "raw") {
+    std::cerr << "run in 'raw' mode" << std::endl;
+    node = std::thread{[=, &cfg] { raw_send(p->second, cfg.size, cfg.count); }};
+    raw_receive(p->first, cfg.count);
+  } else {
+    auto sink = sys.spawn(sink_actor, cfg.count);
+    switch (convert(cfg.mode)) {
+      case bench_mode::io: {
+        std::cerr << "run in 'ioBench' mode" << std::endl;
+        using io::network::scribe_impl;
+        auto& mm = sys.middleman();
+        auto& mpx
+          = dynamic_cast<io::network::default_multiplexer&>(mm.backend());
+        auto bb = mm.named_broker<io::basp_broker>("BASP");
+        io::scribe_ptr scribe = make_counted<scribe_impl>(mpx, p->first.id);
+        anon_send(bb, publish_atom_v, std::move(scribe), uint16_t(8080),
+                  actor_cast<strong_actor_ptr>(sink), std::set<std::string>{});
+        node = std::thread{[=, &cfg] {
+          io_run_source(p->second, 8080, cfg.size, cfg.count);
+        }};
+        break;
+      }
+      case bench_mode::net: {
+        std::cerr << "run in 'netBench' mode" << std::endl;
+        auto& mm = sys.network_manager();
+        auto& backend = *dynamic_cast<net::backend::tcp*>(mm.backend("tcp"));
+        sys.registry().put(std::string("sink"), sink);
+        auto entry = backend.emplace(make_node_id(*make_uri("tcp://source")),
+                                     p->first);
+        if (!entry)
+          exit("emplace failed", entry.error());
+        node = std::thread{
+          [=, &cfg] { net_run_source(p->second, cfg.size, cfg.count); }};
+        break;
+      }
+      default:
+        exit(std::string("invalid mode: \"") + cfg.mode + "\"");
+    }
+  }
+  node.join();
+  watcher.join();
+  auto ttfb = first_byte_us > begin_us ? first_byte_us - begin_us : 0;
+  auto sender_peak = peak_growth(baseline[node_side], node_side);
+  auto receiver_peak = peak_growth(baseline[main_side], main_side);
+  auto rss_after = read_rss().peak_kb;
+  auto total_bytes = static_cast<double>(cfg.size * cfg.count);
+  auto total = duration<double>(microseconds(end_us - begin_us));
+  std::cout << cfg.mode << ", " << cfg.size << ", " << cfg.count << ", "
+            << ttfb << ", " << (end_us - begin_us) << ", "
+            << total_bytes / (1024.0 * 1024.0) / total.count() << ", "
+            << relay->stats().forwarded_bytes - begin_forwarded << ", "
+            << sender_peak << ", " << receiver_peak << ", "
+            << copies(sender_peak, cfg.size) << ", "
+            << copies(receiver_peak, cfg.size) << ", "
+            << (rss_after > rss_before ? rss_after - rss_before : 0)
+            << std::endl;
+}
+
+} // namespace
+
+CAF_MAIN(io::middleman)
@@ -0,0 +1,82 @@
+#include "mailbox_stats.hpp"
+
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "caf/actor.hpp"
+#include "caf/event_based_actor.hpp"
+#include "caf/spawn_options.hpp"
+#include "type_ids.hpp"
+
+using namespace caf;
+using namespace std::chrono;
+
+namespace {
+
+struct mailbox_sample {
+  std::string role;
+  actor_id id;
+  microseconds time;
+  size_t depth;
+  microseconds delay;
+};
+
+const auto epoch = steady_clock::now();
+
+std::atomic<int64_t> interval_ms{0};
+
+std::mutex samples_mtx;
+
+std::vector<mailbox_sample> samples;
+
+microseconds since_epoch() {
+  return duration_cast<microseconds>(steady_clock::now() - epoch);
+}
+
+behavior mailbox_sampler(event_based_actor* self, const actor& target,
+                         milliseconds interval) {
+  self->monitor(target);
+  self->set_down_handler([=](const down_msg&) { self->quit(); });
+  self->delayed_send(self, interval, sample_atom_v);
+  return {
+    [=](sample_atom) {
+      self->send(target, probe_atom_v, since_epoch());
+      self->delayed_send(self, interval, sample_atom_v);
+    },
+  };
+}
+
+} // namespace
+
+void set_mailbox_sampling(milliseconds interval) {
+  interval_ms = interval.count();
+}
+
+bool mailbox_sampling_enabled() {
+  return interval_ms > 0;
+}
+
+void start_mailbox_sampling(event_based_actor* self) {
+  if (auto interval = interval_ms.load(); interval > 0)
+    self->spawn<hidden>(mailbox_sampler, actor_cast<actor>(self),
+                        milliseconds{interval});
+}
+
+void record_mailbox_probe(event_based_actor* self, const char* role,
+                          microseconds sent) {
+  auto now = since_epoch();
+  auto depth = self->mailbox().size();
+  std::lock_guard<std::mutex> guard{samples_mtx};
+  samples.emplace_back(
+    mailbox_sample{role, self->id(), now, depth, now - sent});
+}
+
+void print_mailbox_stats(std::ostream& out) {
+  std::lock_guard<std::mutex> guard{samples_mtx};
+  for (auto& x : samples)
+    out << "mailbox, " << x.role << ", " << x.id << ", "
+        << duration_cast<duration<double, std::milli>>(x.time).count() << ", "
+        << x.depth << ", " << x.delay.count() << std::endl;
+}
@@ -0,0 +1,356 @@
+/******************************************************************************
+ *                       ____    _    _____                                   *
+ *                      / ___|  / \  |  ___|    C++                           *
+ *                     | |     / _ \ | |_       Actor                         *
+ *                     | |___ / ___ \|  _|      Framework                     *
+ *                      \____/_/   \_|_|                                      *
+ *                                                                            *
+ * Copyright (C) 2011 - 2020                                                  *
+ * Jakob Otto <jakob.otto (at) haw-hamburg.de>                                *
+ *                                                                            *
+ * Distributed under the terms and conditions of the BSD 3-Clause License or  *
+ * (at your option) under the terms and conditions of the Boost Software      *
+ * License 1.0. See accompanying files LICENSE and LICENCE_ALTERNATIVE.       *
+ *                                                                            *
+ * If you did not receive a copy of the license files, see                    *
+ * http://opensource.org/licenses/BSD-3-Clause and                            *
+ * http://www.boost.org/LICENSE_1_0.txt.                                      *
+ ******************************************************************************/
+
+// Sends a mix of small and large messages over a single connection and
+// reports the one-way latency of small and large messages separately. With
+// a FIFO write queue, every small message queued behind a large one waits for
+// the large one to hit the wire, so the small-message latency quantifies the
+// head-of-line blocking of the io and net write paths.
+//
+// The sizes come from one of three distributions:
+// - bimodal: `--small-size` or, with probability `--large-fraction`,
+//   `--large-size`
+// - zipf: powers of two between `--small-size` and `--large-size`, where the
+//   k-th size has a weight of 1/k^s with s = `--zipf-exponent`
+// - trace: one size per line in `--trace-file`, repeated as needed
+//
+// The duration goes to stdout. Both latency distributions go to stderr in the
+// format `<class>_latency_us, <count>, <p50>, <p90>, <p99>, <p99.9>, <max>`.
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "accumulator.hpp"
+#include "caf/actor_system_config.hpp"
+#include "caf/all.hpp"
+#include "caf/defaults.hpp"
+#include "caf/io/all.hpp"
+#include "caf/io/network/default_multiplexer.hpp"
+#include "caf/io/network/scribe_impl.hpp"
+#include "caf/io/scribe.hpp"
+#include "caf/net/backend/tcp.hpp"
+#include "caf/net/middleman.hpp"
+#include "caf/net/stream_socket.hpp"
+#include "caf/uri.hpp"
+#include "netem.hpp"
+#include "type_ids.hpp"
+#include "utility.hpp"
+#include "workload.hpp"
+
+using namespace caf;
+using namespace std::chrono;
+
+namespace {
+
+struct config : actor_system_config {
+  config() {
+    init_global_meta_objects<caf::id_block::caf_net_benchmark>();
+    io::middleman::init_global_meta_objects();
+    opt_group{custom_options_, "global"}
+      .add(mode, "mode,m", "one of 'ioBench', or 'netBench'")
+      .add(num_messages, "messages", "number of messages to send")
+      .add(distribution, "distribution,d",
+           "one of 'bimodal', 'zipf' or 'trace'")
+      .add(small_size, "small-size", "smallest message size in byte")
+      .add(large_size, "large-size", "largest message size in byte")
+      .add(large_fraction, "large-fraction",
+           "share of large messages in the bimodal distribution")
+      .add(zipf_exponent, "zipf-exponent",
+           "skew of the zipf distribution towards small messages")
+      .add(trace_file, "trace-file", "file with one message size per line")
+      .add(small_threshold, "small-threshold",
+           "messages up to this size count as small")
+      .add(rate, "rate,r", "messages per second, 0 sends all at once")
+      .add(deadline, "deadline", "abort the run after this many seconds");
+    netem.add_options(custom_options_);
+    data.add_options(custom_options_);
+    earth_id = *make_uri("tcp://earth");
+    put(content, "caf.middleman.this-node", earth_id);
+    put(content, "caf.scheduler.max-threads", 1);
+    load<net::middleman, net::backend::tcp>();
+  }
+
+  std::string mode = "netBench";
+  size_t num_messages = 10000;
+  std::string distribution = "bimodal";
+  size_t small_size = 64;
+  size_t large_size = 4 * 1024 * 1024;
+  double large_fraction = 0.01;
+  double zipf_exponent = 1.5;
+  std::string trace_file;
+  size_t small_threshold = 4096;
+  double rate = 0.0;
+  size_t deadline = 0;
+  workload_config data;
+  netem_config netem;
+  uri earth_id;
+};
+
+microseconds steady_now() {
+  return duration_cast<microseconds>(steady_clock::now().time_since_epoch());
+}
+
+// -- message sizes ------------------------------------------------------------
+
+std::vector<size_t> make_sizes(const config& cfg) {
+  std::vector<size_t> result;
+  result.reserve(cfg.num_messages);
+  std::mt19937_64 gen{cfg.data.seed};
+  if (cfg.distribution == "bimodal") {
+    std::bernoulli_distribution large{cfg.large_fraction};
+    for (size_t i = 0; i < cfg.num_messages; ++i)
+      result.emplace_back(large(gen) ? cfg.large_size : cfg.small_size);
+  } else if (cfg.distribution == "zipf") {
+    std::vector<double> weights;
+    for (auto size = cfg.small_size; size <= cfg.large_size; size *= 2)
+      weights.emplace_back(
+        1.0 / std::pow(static_cast<double>(weights.size() + 1),
+                       cfg.zipf_exponent));
+    std::discrete_distribution<size_t> rank{weights.begin(), weights.end()};
+    for (size_t i = 0; i < cfg.num_messages; ++i)
+      result.emplace_back(cfg.small_size << rank(gen));
+  } else if (cfg.distribution == "trace") {
+    std::ifstream in{cfg.trace_file};
+    std::vector<size_t> trace;
+    for (size_t size = 0; in >> size;)
+      trace.emplace_back(std::max(size, size_t{1}));
+    if (trace.empty())
+      exit("no message sizes in trace file: " + cfg.trace_file);
+    for (size_t i = 0; i < cfg.num_messages; ++i)
+      result.emplace_back(trace[i % trace.size()]);
+  } else {
+    exit("invalid distribution: " + cfg.distribution);
+  }
+  return result;
+}
+
+// -- source actor -------------------------------------------------------------
+
+struct source_state {
+  std::vector<size_t> sizes;
+  size_t next = 0;
+  steady_clock::time_point begin;
+  /// Generated once, every message copies a prefix of it.
+  payload prototype;
+};
+
+/// Sends one message per entry in `sizes` to `sink`, paced to `rate` messages
+/// per second. Every message carries its send time.
+behavior source_actor(stateful_actor<source_state>* self, actor sink,
+                      std::vector<size_t> sizes, double rate) {
+  self->set_exit_handler([=](const exit_msg&) { self->quit(); });
+  self->link_to(sink);
+  self->state.sizes = std::move(sizes);
+  return {
+    [=](init_atom) {
+      auto& st = self->state;
+      auto largest = std::max_element(st.sizes.begin(), st.sizes.end());
+      st.prototype = make_payload(largest != st.sizes.end() ? *largest : 0);
+      self->send(sink, init_atom_v, st.sizes.size());
+    },
+    [=](send_atom) {
+      auto& st = self->state;
+      if (st.next == 0)
+        st.begin = steady_clock::now();
+      auto due = st.sizes.size();
+      if (rate > 0.0) {
+        auto elapsed = duration_cast<duration<double>>(steady_clock::now()
+                                                       - st.begin);
+        due = std::min(due, static_cast<size_t>(elapsed.count() * rate) + 1);
+      }
+      for (; st.next < due; ++st.next) {
+        auto first = st.prototype.begin();
+        self->send(sink, steady_now(),
+                   payload(first, first + st.sizes[st.next]));
+      }
+      if (st.next < st.sizes.size())
+        self->delayed_send(self, 1ms, send_atom_v);
+    },
+  };
+}
+
+// -- sink actor ---------------------------------------------------------------
+
+struct sink_state {
+  size_t expected = 0;
+  size_t received = 0;
+  std::vector<microseconds> small;
+  std::vector<microseconds> large;
+};
+
+template <class T>
+T percentile(const std::vector<T>& sorted, double p) {
+  auto index = static_cast<size_t>(p * static_cast<double>(sorted.size() - 1));
+  return sorted[index];
+}
+
+void print_latencies(const std::string& name, std::vector<microseconds>& xs) {
+  std::cerr << name << "_latency_us, " << xs.size();
+  if (!xs.empty()) {
+    std::sort(xs.begin(), xs.end());
+    std::cerr << ", " << percentile(xs, 0.5).count() << ", "
+              << percentile(xs, 0.9).count() << ", "
+              << percentile(xs, 0.99).count() << ", "
+              << percentile(xs, 0.999).count() << ", " << xs.back().count();
+  }
+  std::cerr << std::endl;
+}
+
+/// Records the one-way latency of every message, split into small and large
+/// messages at `small_threshold` bytes.
+behavior sink_actor(stateful_actor<sink_state>* self, actor accumulator,
+                    size_t small_threshold) {
+  self->set_exit_handler([=](const exit_msg&) { self->quit(); });
+  self->link_to(accumulator);
+  return {
+    [=](init_atom, size_t num_messages) {
+      auto& st = self->state;
+      st.expected = num_messages;
+      st.small.reserve(num_messages);
+      self->send(accumulator, init_atom_v);
+      return send_atom_v;
+    },
+    [=](microseconds sent, const payload& p) {
+      auto& st = self->state;
+      auto latency = steady_now() - sent;
+      if (p.size() <= small_threshold)
+        st.small.emplace_back(latency);
+      else
+        st.large.emplace_back(latency);
+      if (++st.received == st.expected) {
+        print_latencies("small", st.small);
+        print_latencies("large", st.large);
+        self->send(accumulator, done_atom_v);
+      }
+    },
+  };
+}
+
+// -- remote node --------------------------------------------------------------
+
+void io_run_source(net::stream_socket sock, uint16_t port,
+                   std::vector<size_t> sizes, double rate) {
+  actor_system_config cfg;
+  cfg.load<io::middleman>();
+  if (auto err = cfg.parse(0, nullptr))
+    exit(err);
+  apply_thread_settings(cfg);
+  actor_system sys{cfg};
+  using io::network::scribe_impl;
+  auto& mm = sys.middleman();
+  auto& mpx = dynamic_cast<io::network::default_multiplexer&>(mm.backend());
+  io::scribe_ptr scribe = make_counted<scribe_impl>(mpx, sock.id);
+  auto bb = mm.named_broker<io::basp_broker>("BASP");
+  scoped_actor self{sys};
+  self->request(bb, infinite, connect_atom_v, std::move(scribe), port)
+    .receive(
+      [&](node_id&, strong_actor_ptr& ptr, std::set<std::string>&) {
+        if (ptr == nullptr)
+          exit("could not get a handle to the remote sink");
+        auto source = sys.spawn(source_actor, actor_cast<actor>(ptr),
+                                std::move(sizes), rate);
+        anon_send(source, init_atom_v);
+      },
+      [&](error& err) { exit(err); });
+}
+
+void net_run_source(net::stream_socket sock, std::vector<size_t> sizes,
+                    double rate) {
+  auto sink_locator = *make_uri("tcp://earth/name/sink");
+  actor_system_config cfg;
+  cfg.load<net::middleman, net::backend::tcp>();
+  if (auto err = cfg.parse(0, nullptr))
+    exit(err);
+  put(cfg.content, "caf.middleman.this-node", *make_uri("tcp://source"));
+  apply_thread_settings(cfg);
+  if (auto err = cfg.parse(0, nullptr))
+    exit(err);
+  actor_system sys{cfg};
+  auto& mm = sys.network_manager();
+  auto& backend = *dynamic_cast<net::backend::tcp*>(mm.backend("tcp"));
+  auto ret = backend.emplace(make_node_id(*sink_locator.authority_only()),
+                             sock);
+  if (!ret)
+    exit("emplace failed", ret.error());
+  auto sink = mm.remote_actor(sink_locator, 2s);
+  if (!sink)
+    exit(sink.error());
+  auto source = sys.spawn(source_actor, *sink, std::move(sizes), rate);
+  anon_send(source, init_atom_v);
+}
+
+void caf_main(actor_system& sys, const config& cfg) {
+  start_watchdog(std::chrono::seconds(cfg.deadline));
+  share_thread_settings(cfg);
+  cfg.data.apply();
+  if (cfg.small_size == 0 || cfg.large_size < cfg.small_size)
+    exit("sizes must satisfy 0 < small-size <= large-size");
+  auto sizes = make_sizes(cfg);
+  auto num_small = std::count_if(sizes.begin(), sizes.end(), [&](size_t x) {
+    return x <= cfg.small_threshold;
+  });
+  std::cerr << "messages: " << sizes.size() << " (" << num_small << " small)"
+            << std::endl;
+  std::vector<std::unique_ptr<netem_proxy>> proxies;
+  std::thread node;
+  auto accumulator = sys.spawn(accumulator_actor, size_t{1});
+  auto sink = sys.spawn(sink_actor, accumulator, cfg.small_threshold);
+  switch (convert(cfg.mode)) {
+    case bench_mode::io: {
+      using io::network::scribe_impl;
+      auto& mm = sys.middleman();
+      auto& mpx = dynamic_cast<io::network::default_multiplexer&>(mm.backend());
+      auto bb = mm.named_broker<io::basp_broker>("BASP");
+      auto p = *make_connected_tcp_socket_pair(cfg.netem, proxies);
+      io::scribe_ptr scribe = make_counted<scribe_impl>(mpx, p.first.id);
+      anon_send(bb, publish_atom_v, std::move(scribe), uint16_t(8080),
+                actor_cast<strong_actor_ptr>(sink), std::set<std::string>{});
+      node = std::thread{[=, &cfg] {
+        io_run_source(p.second, 8080, std::move(sizes), cfg.rate);
+      }};
+      break;
+    }
+    case bench_mode::net: {
+      auto& mm = sys.network_manager();
+      auto& backend = *dynamic_cast<net::backend::tcp*>(mm.backend("tcp"));
+      sys.registry().put(std::string("sink"), sink);
+      auto p = *make_connected_tcp_socket_pair(cfg.netem, proxies);
+      backend.emplace(make_node_id(*make_uri("tcp://source")), p.first);
+      node = std::thread{
+        [=, &cfg] { net_run_source(p.second, std::move(sizes), cfg.rate); }};
+      break;
+    }
+    default:
+      exit(std::string("invalid mode: \"") + cfg.mode + "\"");
+  }
+  node.join();
+}
+
+} // namespace
+
+CAF_MAIN(io::middleman)
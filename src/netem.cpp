@@ -0,0 +1,408 @@
+#include "netem.hpp"
+
+#include <algorithm>
+#include <array>
+#include <deque>
+#include <fstream>
+#include <poll.h>
+#include <queue>
+#include <sstream>
+
+#include "caf/config_option_adder.hpp"
+#include "caf/config_option_set.hpp"
+#include "caf/detail/socket_sys_includes.hpp"
+#include "caf/net/socket.hpp"
+#include "caf/net/socket_guard.hpp"
+#include "caf/net/tcp_stream_socket.hpp"
+#include "caf/sec.hpp"
+#include "caf/span.hpp"
+#include "utility.hpp"
+
+using namespace caf;
+using namespace std::chrono;
+
+namespace {
+
+/// Upper bound for the time the relay thread blocks in `poll`.
+constexpr auto max_poll_timeout = milliseconds(10);
+
+/// Size of a single relayed TCP chunk. Keeping chunks small keeps the rate
+/// limiting smooth for low bandwidths.
+constexpr size_t tcp_chunk_size = 16 * 1024;
+
+int poll_timeout(netem_proxy::clock_type::time_point now,
+                 netem_proxy::clock_type::time_point next) {
+  if (next <= now)
+    return 0;
+  auto timeout = std::min(duration_cast<milliseconds>(next - now),
+                          max_poll_timeout);
+  return std::max(static_cast<int>(timeout.count()), 1);
+}
+
+} // namespace
+
+// -- netem_config -------------------------------------------------------------
+
+void netem_config::add_options(config_option_set& opts) {
+  config_option_adder{opts, "netem"}
+    .add(latency_us, "latency", "one-way delay of the emulated link in us")
+    .add(jitter_us, "jitter", "uniform variation of the delay in us")
+    .add(bandwidth, "bandwidth", "link capacity in bytes/s (0 = unlimited)")
+    .add(loss, "loss", "probability of dropping a datagram (UDP only)")
+    .add(reorder, "reorder", "probability of reordering a datagram (UDP only)")
+    .add(queue_limit, "queue-limit", "bytes buffered per direction")
+    .add(seed, "seed", "seed for loss, reordering and jitter")
+    .add(schedule_file, "schedule", "file with one link phase per line");
+}
+
+bool netem_config::enabled() const {
+  return latency_us > 0 || jitter_us > 0 || bandwidth > 0 || loss > 0.0
+         || reorder > 0.0 || !schedule_file.empty();
+}
+
+std::vector<netem_phase> netem_config::schedule() const {
+  std::vector<netem_phase> result;
+  if (schedule_file.empty()) {
+    netem_phase phase;
+    phase.latency = microseconds(latency_us);
+    phase.jitter = microseconds(jitter_us);
+    phase.bandwidth = bandwidth;
+    phase.loss = loss;
+    phase.reorder = reorder;
+    result.emplace_back(phase);
+    return result;
+  }
+  std::ifstream in{schedule_file};
+  if (!in)
+    exit("could not open netem schedule " + schedule_file);
+  std::string line;
+  while (std::getline(in, line)) {
+    if (line.empty() || line.front() == '#')
+      continue;
+    std::istringstream fields{line};
+    size_t duration = 0;
+    size_t latency = 0;
+    size_t jitter = 0;
+    netem_phase phase;
+    if (!(fields >> duration >> latency >> jitter >> phase.bandwidth
+          >> phase.loss >> phase.reorder))
+      exit("invalid line in netem schedule: " + line);
+    phase.duration = milliseconds(duration);
+    phase.latency = microseconds(latency);
+    phase.jitter = microseconds(jitter);
+    result.emplace_back(phase);
+  }
+  if (result.empty())
+    exit("netem schedule " + schedule_file + " contains no phases");
+  return result;
+}
+
+// -- netem_proxy --------------------------------------------------------------
+
+netem_proxy::netem_proxy(const netem_config& cfg)
+  : cfg_(cfg), phases_(cfg.schedule()), rng_(cfg.seed) {
+  // nop
+}
+
+netem_proxy::~netem_proxy() {
+  stop();
+}
+
+void netem_proxy::stop() {
+  running_ = false;
+  if (thread_.joinable())
+    thread_.join();
+}
+
+void netem_proxy::launch() {
+  start_ = clock_type::now();
+  running_ = true;
+  thread_ = std::thread{[this] { run(); }};
+}
+
+const netem_phase&
+netem_proxy::current_phase(clock_type::time_point now) const {
+  auto elapsed = duration_cast<milliseconds>(now - start_);
+  for (const auto& phase : phases_) {
+    if (phase.duration.count() == 0 || elapsed < phase.duration)
+      return phase;
+    elapsed -= phase.duration;
+  }
+  return phases_.back();
+}
+
+netem_proxy::clock_type::time_point
+netem_proxy::departure(clock_type::time_point now,
+                       clock_type::time_point& link_free, size_t size) {
+  const auto& phase = current_phase(now);
+  auto begin = std::max(now, link_free);
+  link_free = begin;
+  if (phase.bandwidth > 0)
+    link_free += nanoseconds(size * 1'000'000'000ull / phase.bandwidth);
+  auto delay = phase.latency;
+  if (phase.jitter.count() > 0) {
+    std::uniform_int_distribution<int64_t> dist{-phase.jitter.count(),
+                                                phase.jitter.count()};
+    delay = std::max(microseconds(0), delay + microseconds(dist(rng_)));
+  }
+  return link_free + delay;
+}
+
+bool netem_proxy::roll(double probability) {
+  if (probability <= 0.0)
+    return false;
+  return std::uniform_real_distribution<double>{0.0, 1.0}(rng_) < probability;
+}
+
+void netem_proxy::record_forwarded(size_t bytes) {
+  int64_t expected = 0;
+  stats_.first_byte_us.compare_exchange_strong(expected,
+                                               now<microseconds>().count());
+  stats_.forwarded_bytes += bytes;
+  ++stats_.forwarded_packets;
+}
+
+// -- netem_tcp_proxy ----------------------------------------------------------
+
+netem_tcp_proxy::~netem_tcp_proxy() {
+  stop();
+  if (left_ != net::invalid_socket)
+    net::close(left_);
+  if (right_ != net::invalid_socket)
+    net::close(right_);
+}
+
+expected<std::pair<net::stream_socket, net::stream_socket>>
+netem_tcp_proxy::start() {
+  auto left = make_connected_tcp_socket_pair();
+  if (!left)
+    return left.error();
+  auto left_app = net::make_socket_guard(left->first);
+  auto left_relay = net::make_socket_guard(left->second);
+  auto right = make_connected_tcp_socket_pair();
+  if (!right)
+    return right.error();
+  auto right_relay = net::make_socket_guard(right->first);
+  auto right_app = net::make_socket_guard(right->second);
+  for (auto sock : {left_relay.socket(), right_relay.socket()}) {
+    if (auto err = net::nodelay(sock, true))
+      return err;
+    if (auto err = net::nonblocking(sock, true))
+      return err;
+  }
+  left_ = left_relay.release();
+  right_ = right_relay.release();
+  launch();
+  return std::make_pair(left_app.release(), right_app.release());
+}
+
+void netem_tcp_proxy::run() {
+  struct chunk {
+    clock_type::time_point due;
+    std::vector<byte> data;
+    size_t offset = 0;
+  };
+  struct direction {
+    net::stream_socket in;
+    net::stream_socket out;
+    std::deque<chunk> queue;
+    size_t queued = 0;
+    clock_type::time_point link_free;
+    bool eof = false;
+    bool closed = false;
+  };
+  std::array<direction, 2> dirs;
+  dirs[0].in = left_;
+  dirs[0].out = right_;
+  dirs[1].in = right_;
+  dirs[1].out = left_;
+  std::array<byte, tcp_chunk_size> buf;
+  while (running_) {
+    auto now = clock_type::now();
+    // Deliver everything that left the emulated link.
+    for (auto& dir : dirs) {
+      while (!dir.queue.empty() && dir.queue.front().due <= now) {
+        auto& front = dir.queue.front();
+        auto ret = net::write(dir.out,
+                              make_span(front.data.data() + front.offset,
+                                        front.data.size() - front.offset));
+        if (ret > 0) {
+          front.offset += static_cast<size_t>(ret);
+          dir.queued -= static_cast<size_t>(ret);
+          record_forwarded(static_cast<size_t>(ret));
+          if (front.offset == front.data.size())
+            dir.queue.pop_front();
+        } else if (ret < 0 && net::last_socket_error_is_temporary()) {
+          break;
+        } else {
+          running_ = false;
+          return;
+        }
+      }
+      if (dir.eof && dir.queue.empty() && !dir.closed) {
+        ::shutdown(dir.out.id, SHUT_WR);
+        dir.closed = true;
+      }
+    }
+    if (dirs[0].closed && dirs[1].closed)
+      break;
+    // Wait for new data or the next due chunk.
+    auto next = now + max_poll_timeout;
+    std::array<short, 2> events{0, 0};
+    for (size_t i = 0; i < dirs.size(); ++i) {
+      auto& dir = dirs[i];
+      if (!dir.eof && dir.queued < cfg_.queue_limit)
+        events[i] |= POLLIN;
+      if (!dir.queue.empty()) {
+        if (dir.queue.front().due <= now)
+          events[1 - i] |= POLLOUT;
+        else
+          next = std::min(next, dir.queue.front().due);
+      }
+    }
+    // Sockets without events stay out of the poll set, since poll would keep
+    // reporting a hang-up on them.
+    std::array<pollfd, 2> fds;
+    std::array<size_t, 2> fd_dirs;
+    nfds_t num_fds = 0;
+    for (size_t i = 0; i < dirs.size(); ++i) {
+      if (events[i] != 0) {
+        fds[num_fds] = pollfd{dirs[i].in.id, events[i], 0};
+        fd_dirs[num_fds++] = i;
+      }
+    }
+    if (::poll(fds.data(), num_fds, poll_timeout(now, next)) < 0) {
+      if (errno == EINTR)
+        continue;
+      break;
+    }
+    for (size_t i = 0; i < num_fds; ++i) {
+      auto& dir = dirs[fd_dirs[i]];
+      if ((fds[i].revents & (POLLIN | POLLHUP | POLLERR)) == 0 || dir.eof
+          || dir.queued >= cfg_.queue_limit)
+        continue;
+      auto ret = net::read(dir.in, make_span(buf));
+      if (ret > 0) {
+        auto size = static_cast<size_t>(ret);
+        auto arrival = clock_type::now();
+        chunk c;
+        c.due = departure(arrival, dir.link_free, size);
+        // TCP never reorders, so jitter may only stretch the gaps.
+        if (!dir.queue.empty())
+          c.due = std::max(c.due, dir.queue.back().due);
+        c.data.assign(buf.begin(), buf.begin() + size);
+        dir.queued += size;
+        dir.queue.emplace_back(std::move(c));
+      } else if (ret == 0 || !net::last_socket_error_is_temporary()) {
+        dir.eof = true;
+      }
+    }
+  }
+}
+
+// -- netem_udp_proxy ----------------------------------------------------------
+
+netem_udp_proxy::~netem_udp_proxy() {
+  stop();
+  if (sock_ != net::invalid_socket)
+    net::close(sock_);
+}
+
+expected<uint16_t> netem_udp_proxy::start(ip_endpoint target) {
+  target_ = target;
+  ip_endpoint local{target.address(), 0};
+  auto ret = net::make_udp_datagram_socket(local);
+  if (!ret)
+    return ret.error();
+  sock_ = ret->first;
+  if (auto err = net::nonblocking(sock_, true))
+    return err;
+  launch();
+  return ret->second;
+}
+
+void netem_udp_proxy::run() {
+  struct datagram {
+    clock_type::time_point due;
+    std::vector<byte> data;
+    ip_endpoint receiver;
+  };
+  auto later = [](const datagram& x, const datagram& y) {
+    return x.due > y.due;
+  };
+  std::priority_queue<datagram, std::vector<datagram>, decltype(later)> queue{
+    later};
+  std::array<clock_type::time_point, 2> link_free;
+  ip_endpoint client;
+  bool has_client = false;
+  std::vector<byte> buf(65536);
+  while (running_) {
+    auto now = clock_type::now();
+    while (!queue.empty() && queue.top().due <= now) {
+      const auto& top = queue.top();
+      // Datagrams that the kernel refuses are lost like on a real link, but
+      // count separately from the emulated loss.
+      auto ret = net::write(sock_, make_span(top.data), top.receiver);
+      if (get_if<sec>(&ret) != nullptr)
+        ++stats_.failed_packets;
+      else
+        record_forwarded(top.data.size());
+      queue.pop();
+    }
+    auto next = now + max_poll_timeout;
+    if (!queue.empty())
+      next = std::min(next, queue.top().due);
+    pollfd fd{sock_.id, POLLIN, 0};
+    if (::poll(&fd, 1, poll_timeout(now, next)) < 0) {
+      if (errno == EINTR)
+        continue;
+      break;
+    }
+    if ((fd.revents & POLLIN) == 0)
+      continue;
+    auto ret = net::read(sock_, make_span(buf));
+    auto res = get_if<std::pair<size_t, ip_endpoint>>(&ret);
+    if (!res)
+      continue;
+    auto [size, sender] = *res;
+    size_t dir = 0;
+    datagram dgram;
+    if (sender == target_) {
+      if (!has_client)
+        continue;
+      dir = 1;
+      dgram.receiver = client;
+    } else {
+      client = sender;
+      has_client = true;
+      dgram.receiver = target_;
+    }
+    auto arrival = clock_type::now();
+    const auto& phase = current_phase(arrival);
+    if (roll(phase.loss)) {
+      ++stats_.dropped_packets;
+      continue;
+    }
+    dgram.due = departure(arrival, link_free[dir], size);
+    if (roll(phase.reorder)) {
+      dgram.due += phase.latency + phase.jitter + milliseconds(1);
+      ++stats_.reordered_packets;
+    }
+    dgram.data.assign(buf.begin(), buf.begin() + size);
+    queue.emplace(std::move(dgram));
+  }
+}
+
+// -- free functions -----------------------------------------------------------
+
+expected<std::pair<net::stream_socket, net::stream_socket>>
+make_connected_tcp_socket_pair(
+  const netem_config& cfg, std::vector<std::unique_ptr<netem_proxy>>& proxies) {
+  if (!cfg.enabled())
+    return make_connected_tcp_socket_pair();
+  auto proxy = std::make_unique<netem_tcp_proxy>(cfg);
+  auto res = proxy->start();
+  if (res)
+    proxies.emplace_back(std::move(proxy));
+  return res;
+}
@@ -0,0 +1,388 @@
+/******************************************************************************
+ *                       ____    _    _____                                   *
+ *                      / ___|  / \  |  ___|    C++                           *
+ *                     | |     / _ \ | |_       Actor                         *
+ *                     | |___ / ___ \|  _|      Framework                     *
+ *                      \____/_/   \_|_|                                      *
+ *                                                                            *
+ * Copyright (C) 2011 - 2020                                                  *
+ * Jakob Otto <jakob.otto (at) haw-hamburg.de>                                *
+ *                                                                            *
+ * Distributed under the terms and conditions of the BSD 3-Clause License or  *
+ * (at your option) under the terms and conditions of the Boost Software      *
+ * License 1.0. See accompanying files LICENSE and LICENCE_ALTERNATIVE.       *
+ *                                                                            *
+ * If you did not receive a copy of the license files, see                    *
+ * http://opensource.org/licenses/BSD-3-Clause and                            *
+ * http://www.boost.org/LICENSE_1_0.txt.                                      *
+ ******************************************************************************/
+
+// Fans in traffic from many simulated remote nodes into one actor system over
+// caf-net. Instead of a thread and an actor system per node, each simulated
+// node is just a TCP connection with its own node ID that speaks BASP on the
+// wire: it sends the handshake and then pre-serialized actor messages to its
+// sink. A small pool of threads drives all simulated nodes, which allows
+// sweeping the number of peers into the thousands.
+//
+// Every run prints one row:
+//   nodes, duration_us, mib_s, rss_per_connection_bytes, poll_us,
+//   cpu_us_per_msg
+// Both ends live in this process, so the RSS delta per connection covers the
+// state the receiving system allocates per peer plus the simulator's end of the
+// connection, i.e., the reply buffer and the share of the simulator threads.
+// The simulated nodes build their messages before the first RSS reading, so
+// these buffers are excluded.
+// `poll_us` is the cost of a single poll over all connections of the receiving
+// side, `cpu_us_per_msg` the CPU time of the receiving side per message.
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <poll.h>
+#include <sys/resource.h>
+#include <thread>
+#include <vector>
+
+#include "alloc_stats.hpp"
+#include "caf/actor_system_config.hpp"
+#include "caf/all.hpp"
+#include "caf/binary_serializer.hpp"
+#include "caf/byte_buffer.hpp"
+#include "caf/net/backend/tcp.hpp"
+#include "caf/net/basp/header.hpp"
+#include "caf/net/basp/message_type.hpp"
+#include "caf/net/middleman.hpp"
+#include "caf/net/socket.hpp"
+#include "caf/net/stream_socket.hpp"
+#include "caf/span.hpp"
+#include "caf/uri.hpp"
+#include "streaming_actors.hpp"
+#include "type_ids.hpp"
+#include "utility.hpp"
+#include "workload.hpp"
+
+using namespace caf;
+using namespace std::chrono;
+
+namespace {
+
+using clock_type = std::chrono::steady_clock;
+
+/// Minimum number of bytes a simulated node hands to a single write call.
+constexpr size_t burst_size = 16 * 1024;
+
+struct config : actor_system_config {
+  config() {
+    init_global_meta_objects<caf::id_block::caf_net_benchmark>();
+    net::middleman::init_global_meta_objects();
+    opt_group{custom_options_, "global"}
+      .add(num_nodes, "num-nodes,n", "number of simulated remote nodes")
+      .add(sim_threads, "sim-threads,t",
+           "number of threads driving the simulated nodes")
+      .add(streaming_amount, "amount,a", "bytes each simulated node sends")
+      .add(message_size, "size,s", "size of the payload in byte")
+      .add(poll_rounds, "poll-rounds", "polls for measuring the poll cost")
+      .add(deadline, "deadline", "abort the run after this many seconds");
+    data.add_options(custom_options_);
+    put(content, "caf.middleman.this-node", *make_uri("tcp://earth"));
+    put(content, "caf.scheduler.max-threads", 1);
+    load<net::middleman, net::backend::tcp>();
+  }
+
+  size_t num_nodes = 64;
+  size_t sim_threads = 4;
+  size_t streaming_amount = 1024 * 1024;
+  size_t message_size = 1024;
+  size_t poll_rounds = 100;
+  size_t deadline = 0;
+  workload_config data;
+};
+
+// -- BASP encoding ------------------------------------------------------------
+
+void append_frame(net::basp::message_type type, uint64_t operation_data,
+                  const byte_buffer& payload_buf, byte_buffer& out) {
+  net::basp::header hdr{type, static_cast<uint32_t>(payload_buf.size()),
+                        operation_data};
+  net::basp::to_bytes(hdr, out);
+  out.insert(out.end(), payload_buf.begin(), payload_buf.end());
+}
+
+byte_buffer handshake_frame(actor_system& sys, const node_id& id) {
+  auto app_ids = get_or(sys.config(), "caf.middleman.app-identifiers",
+                        std::vector<std::string>{"generic-caf-app"});
+  byte_buffer payload_buf;
+  binary_serializer sink{sys, payload_buf};
+  if (!sink.apply_object(id) || !sink.apply_object(app_ids))
+    exit("serializing the handshake failed", sink.get_error());
+  byte_buffer result;
+  append_frame(net::basp::message_type::handshake, net::basp::version,
+               payload_buf, result);
+  return result;
+}
+
+/// Appends an anonymous actor message for `dst` to `out`.
+void append_actor_message(actor_system& sys, actor_id dst,
+                          const message& content, byte_buffer& out) {
+  node_id src_node;
+  actor_id src_id = 0;
+  std::vector<strong_actor_ptr> stages;
+  byte_buffer payload_buf;
+  binary_serializer sink{sys, payload_buf};
+  if (!sink.apply_object(src_node) || !sink.apply_object(src_id)
+      || !sink.apply_object(dst) || !sink.apply_object(stages)
+      || !sink.apply_object(content))
+    exit("serializing an actor message failed", sink.get_error());
+  append_frame(net::basp::message_type::actor_message, 0, payload_buf, out);
+}
+
+// -- simulated nodes ----------------------------------------------------------
+
+struct simulated_node {
+  net::stream_socket sock;
+  /// Handshake of this node.
+  byte_buffer handshake;
+  /// Initial message to the sink.
+  byte_buffer prefix;
+  /// Whole payload messages, sent over and over again.
+  byte_buffer burst;
+  /// Total number of bytes in payload messages.
+  size_t total = 0;
+  size_t sent = 0;
+  size_t prefix_sent = 0;
+  /// Handshake bytes received from the sink's system so far.
+  byte_buffer inbox;
+  bool handshake_done = false;
+
+  bool done() const noexcept {
+    return prefix_sent == prefix.size() && sent == total;
+  }
+};
+
+/// Synchronizes the simulator threads with the measurement in `caf_main`.
+struct phase_sync {
+  std::atomic<size_t> ready{0};
+  std::atomic<bool> go{false};
+  std::atomic<int64_t> cpu_us{0};
+};
+
+int64_t thread_cpu_us() {
+  rusage usage;
+  getrusage(RUSAGE_THREAD, &usage);
+  return usage.ru_utime.tv_sec * 1'000'000 + usage.ru_utime.tv_usec
+         + usage.ru_stime.tv_sec * 1'000'000 + usage.ru_stime.tv_usec;
+}
+
+int64_t process_cpu_us() {
+  rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+  return usage.ru_utime.tv_sec * 1'000'000 + usage.ru_utime.tv_usec
+         + usage.ru_stime.tv_sec * 1'000'000 + usage.ru_stime.tv_usec;
+}
+
+/// Writes as much of `buf` as the socket accepts and returns the number of
+/// bytes written.
+size_t try_write(net::stream_socket sock, const byte* data, size_t size) {
+  auto ret = net::write(sock, make_span(data, size));
+  if (ret > 0)
+    return static_cast<size_t>(ret);
+  if (ret < 0 && !net::last_socket_error_is_temporary())
+    exit("simulated node failed to write", sec::socket_operation_failed);
+  return 0;
+}
+
+/// Reads the handshake of the receiving system and returns whether it
+/// arrived completely. Later data is read and dropped.
+bool drain(simulated_node& node) {
+  byte buf[1024];
+  for (;;) {
+    auto ret = net::read(node.sock, make_span(buf, sizeof(buf)));
+    if (ret > 0) {
+      if (!node.handshake_done)
+        node.inbox.insert(node.inbox.end(), buf, buf + ret);
+    } else if (ret == 0 || !net::last_socket_error_is_temporary()) {
+      exit("receiving system closed the connection",
+           sec::socket_disconnected);
+    } else {
+      break;
+    }
+  }
+  if (!node.handshake_done && node.inbox.size() >= net::basp::header_size) {
+    auto hdr = net::basp::header::from_bytes(node.inbox);
+    if (node.inbox.size() >= net::basp::header_size + hdr.payload_len) {
+      node.handshake_done = true;
+      node.inbox = byte_buffer{};
+    }
+  }
+  return node.handshake_done;
+}
+
+/// Polls `nodes` for `events` and calls `f` for each ready node until `f`
+/// returned true for all of them.
+template <class F>
+void poll_until(std::vector<simulated_node*>& nodes, short events, F f) {
+  std::vector<simulated_node*> pending = nodes;
+  std::vector<pollfd> fds;
+  while (!pending.empty()) {
+    fds.clear();
+    for (auto node : pending)
+      fds.push_back(pollfd{node->sock.id, events, 0});
+    if (poll(fds.data(), fds.size(), 1000) < 0)
+      exit("poll failed", sec::runtime_error);
+    std::vector<simulated_node*> still_pending;
+    for (size_t i = 0; i < fds.size(); ++i)
+      if (fds[i].revents == 0 || !f(*pending[i]))
+        still_pending.push_back(pending[i]);
+    pending.swap(still_pending);
+  }
+}
+
+void simulate(std::vector<simulated_node*> nodes, phase_sync& sync) {
+  // Handshake: send ours and wait for the one of the receiving system.
+  for (auto node : nodes) {
+    size_t written = 0;
+    while (written < node->handshake.size())
+      written += try_write(node->sock, node->handshake.data() + written,
+                           node->handshake.size() - written);
+  }
+  poll_until(nodes, POLLIN, [](simulated_node& node) { return drain(node); });
+  ++sync.ready;
+  while (!sync.go)
+    std::this_thread::sleep_for(1ms);
+  // Streaming: write the initial message, then cycle through the burst.
+  auto cpu_begin = thread_cpu_us();
+  poll_until(nodes, POLLIN | POLLOUT, [](simulated_node& node) {
+    drain(node);
+    while (node.prefix_sent < node.prefix.size()) {
+      auto n = try_write(node.sock, node.prefix.data() + node.prefix_sent,
+                         node.prefix.size() - node.prefix_sent);
+      if (n == 0)
+        return false;
+      node.prefix_sent += n;
+    }
+    while (node.sent < node.total) {
+      auto offset = node.sent % node.burst.size();
+      auto size = std::min(node.burst.size() - offset, node.total - node.sent);
+      auto n = try_write(node.sock, node.burst.data() + offset, size);
+      if (n == 0)
+        return false;
+      node.sent += n;
+    }
+    return true;
+  });
+  sync.cpu_us += thread_cpu_us() - cpu_begin;
+}
+
+/// Raises the soft limit for open files, each simulated node needs two.
+void raise_fd_limit(size_t required) {
+  rlimit limit;
+  if (getrlimit(RLIMIT_NOFILE, &limit) != 0)
+    return;
+  if (limit.rlim_cur < required) {
+    limit.rlim_cur = std::min<rlim_t>(limit.rlim_max, required);
+    setrlimit(RLIMIT_NOFILE, &limit);
+  }
+  if (limit.rlim_cur < required)
+    std::cerr << "WARNING: only " << limit.rlim_cur << " file descriptors for "
+              << required << " required, raise the hard limit" << std::endl;
+}
+
+void caf_main(actor_system& sys, const config& cfg) {
+  start_watchdog(std::chrono::seconds(cfg.deadline));
+  share_thread_settings(cfg);
+  cfg.data.apply();
+  if (cfg.message_size == 0 || cfg.num_nodes == 0 || cfg.sim_threads == 0)
+    exit("size, nodes and threads must be greater than zero");
+  raise_fd_limit(2 * cfg.num_nodes + 64);
+  auto& mm = sys.network_manager();
+  auto& backend = *dynamic_cast<net::backend::tcp*>(mm.backend("tcp"));
+  // The scoped actor takes the role of the accumulator.
+  scoped_actor self{sys};
+  auto num_messages = std::max(cfg.streaming_amount / cfg.message_size,
+                               size_t{1});
+  auto frames_per_burst = std::max(burst_size / cfg.message_size, size_t{1});
+  frames_per_burst = std::min(frames_per_burst, num_messages);
+  std::vector<simulated_node> nodes(cfg.num_nodes);
+  std::vector<node_id> node_ids;
+  for (size_t i = 0; i < cfg.num_nodes; ++i) {
+    auto sink = sys.spawn(sink_actor, actor(self), credit_config{});
+    sys.registry().put(sink.id(), actor_cast<strong_actor_ptr>(sink));
+    auto id = make_node_id(*make_uri("tcp://sim" + std::to_string(i)));
+    auto& node = nodes[i];
+    node.handshake = handshake_frame(sys, id);
+    append_actor_message(sys, sink.id(),
+                         make_message(init_atom_v,
+                                      num_messages * cfg.message_size),
+                         node.prefix);
+    append_actor_message(sys, sink.id(),
+                         make_workload_message(cfg.message_size, i),
+                         node.burst);
+    auto frame_size = node.burst.size();
+    for (size_t j = 1; j < frames_per_burst; ++j)
+      node.burst.insert(node.burst.end(), node.burst.begin(),
+                        node.burst.begin() + frame_size);
+    node.total = num_messages * frame_size;
+    node_ids.emplace_back(std::move(id));
+  }
+  // Connect all simulated nodes and wait for the handshakes. The delta covers
+  // both ends of each connection.
+  auto rss_before = read_rss().current_kb;
+  std::vector<pollfd> receiver_fds;
+  for (size_t i = 0; i < cfg.num_nodes; ++i) {
+    auto sockets = make_connected_tcp_socket_pair();
+    if (!sockets)
+      exit("connecting simulated node failed", sockets.error());
+    if (auto err = net::nonblocking(sockets->second, true))
+      exit("nonblocking failed", err);
+    receiver_fds.push_back(pollfd{sockets->first.id, POLLIN, 0});
+    nodes[i].sock = sockets->second;
+    if (auto ret = backend.emplace(node_ids[i], sockets->first); !ret)
+      exit("emplace failed", ret.error());
+  }
+  phase_sync sync;
+  std::vector<std::thread> threads;
+  auto num_threads = std::min(cfg.sim_threads, cfg.num_nodes);
+  for (size_t t = 0; t < num_threads; ++t) {
+    std::vector<simulated_node*> share;
+    for (size_t i = t; i < nodes.size(); i += num_threads)
+      share.push_back(&nodes[i]);
+    threads.emplace_back(simulate, std::move(share), std::ref(sync));
+  }
+  while (sync.ready < num_threads)
+    std::this_thread::sleep_for(1ms);
+  auto rss_after = read_rss().current_kb;
+  // Poll over the receiving sockets like the multiplexer does on every loop.
+  auto poll_begin = clock_type::now();
+  for (size_t i = 0; i < cfg.poll_rounds; ++i)
+    poll(receiver_fds.data(), receiver_fds.size(), 0);
+  auto poll_time = duration_cast<duration<double, std::micro>>(
+    clock_type::now() - poll_begin);
+  // Stream and wait for every sink.
+  auto cpu_begin = process_cpu_us();
+  auto begin = clock_type::now();
+  sync.go = true;
+  for (size_t done = 0; done < cfg.num_nodes;)
+    self->receive([](init_atom) {}, [&](done_atom) { ++done; });
+  auto end = clock_type::now();
+  for (auto& thread : threads)
+    thread.join();
+  auto cpu_us = process_cpu_us() - cpu_begin - sync.cpu_us;
+  auto total_messages = num_messages * cfg.num_nodes;
+  auto secs = duration_cast<duration<double>>(end - begin).count();
+  auto mib = static_cast<double>(total_messages * cfg.message_size)
+             / (1024.0 * 1024.0);
+  std::cout << cfg.num_nodes << ", "
+            << duration_cast<microseconds>(end - begin).count() << ", "
+            << (secs > 0.0 ? mib / secs : 0.0) << ", "
+            << (rss_after > rss_before ? rss_after - rss_before : 0) * 1024
+                 / cfg.num_nodes
+            << ", " << poll_time.count() / std::max(cfg.poll_rounds, size_t{1})
+            << ", "
+            << static_cast<double>(cpu_us) / static_cast<double>(total_messages)
+            << std::endl;
+}
+
+} // namespace
+
+CAF_MAIN(net::middleman)
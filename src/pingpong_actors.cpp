@@ -0,0 +1,245 @@
+#include "pingpong_actors.hpp"
+
+#include <algorithm>
+
+#include "caf/actor.hpp"
+#include "caf/behavior.hpp"
+#include "caf/event_based_actor.hpp"
+#include "caf/exit_reason.hpp"
+#include "caf/stateful_actor.hpp"
+#include "mailbox_stats.hpp"
+#include "type_ids.hpp"
+#include "utility.hpp"
+#include "workload.hpp"
+
+using namespace caf;
+using std::chrono::duration_cast;
+using std::chrono::microseconds;
+using std::chrono::milliseconds;
+
+behavior ping_actor(stateful_actor<ping_state>* self, const actor& accumulator,
+                    size_t num_pings, size_t payload_size) {
+  self->set_exit_handler([=](const exit_msg&) { self->quit(); });
+  self->link_to(accumulator);
+  return {
+    [=](init_atom) {
+      self->send(accumulator, init_atom_v);
+      return make_workload_message(payload_size);
+    },
+    [=](const payload& p) {
+      if (++self->state.count >= num_pings)
+        self->send(accumulator, done_atom_v);
+      return p;
+    },
+    [=](const record_batch& xs) {
+      if (++self->state.count >= num_pings)
+        self->send(accumulator, done_atom_v);
+      return xs;
+    },
+  };
+}
+
+behavior timed_ping_actor(stateful_actor<timed_ping_state>* self,
+                          const actor& accumulator, const actor& collector,
+                          size_t num_pings, size_t payload_size) {
+  using std::chrono::steady_clock;
+  self->set_exit_handler([=](const exit_msg&) { self->quit(); });
+  self->link_to(accumulator);
+  self->state.rtts.reserve(num_pings);
+  // Records the round trip and returns whether to send another ping.
+  auto round_trip = [=] {
+    auto& st = self->state;
+    auto ts = steady_clock::now();
+    st.rtts.emplace_back(duration_cast<microseconds>(ts - st.last));
+    st.last = ts;
+    if (++st.count < num_pings)
+      return true;
+    self->send(accumulator, done_atom_v);
+    self->send(collector, done_atom_v, st.begin, now<microseconds>(),
+               std::move(st.rtts));
+    return false;
+  };
+  return {
+    [=](init_atom) {
+      // The pong reaches us through a dispatcher, so link to it directly to
+      // take it down with us.
+      self->link_to(actor_cast<actor>(self->current_sender()));
+      self->send(accumulator, init_atom_v);
+      self->state.begin = now<microseconds>();
+      self->state.last = steady_clock::now();
+      return make_workload_message(payload_size);
+    },
+    // Sends the echo explicitly, because the last round trip has no reply.
+    [=](const payload& p) {
+      if (round_trip())
+        self->send(actor_cast<actor>(self->current_sender()), p);
+      else
+        self->quit();
+    },
+    [=](const record_batch& xs) {
+      if (round_trip())
+        self->send(actor_cast<actor>(self->current_sender()), xs);
+      else
+        self->quit();
+    },
+  };
+}
+
+namespace {
+
+/// Requests an echo of `x` from `pong` and issues the next request from the
+/// response handler for as long as `round_trip` returns true.
+template <class T, class F>
+void request_next(stateful_actor<timed_ping_state>* self, const actor& pong,
+                  T x, milliseconds timeout, F round_trip) {
+  self->request(pong, timeout, std::move(x))
+    .then(
+      [=](T& echo) {
+        if (round_trip())
+          request_next(self, pong, std::move(echo), timeout, round_trip);
+      },
+      [=](error& err) { exit("ping request failed", err); });
+}
+
+} // namespace
+
+behavior request_ping_actor(stateful_actor<timed_ping_state>* self,
+                            const actor& accumulator, const actor& collector,
+                            size_t num_pings, size_t payload_size,
+                            milliseconds timeout) {
+  using std::chrono::steady_clock;
+  self->set_exit_handler([=](const exit_msg&) { self->quit(); });
+  self->link_to(accumulator);
+  self->state.rtts.reserve(num_pings);
+  auto round_trip = [=] {
+    auto& st = self->state;
+    auto ts = steady_clock::now();
+    st.rtts.emplace_back(duration_cast<microseconds>(ts - st.last));
+    st.last = ts;
+    if (++st.count < num_pings)
+      return true;
+    self->send(accumulator, done_atom_v);
+    self->send(collector, done_atom_v, st.begin, now<microseconds>(),
+               std::move(st.rtts));
+    return false;
+  };
+  return {
+    [=](init_atom) {
+      auto pong = actor_cast<actor>(self->current_sender());
+      self->link_to(pong);
+      self->send(accumulator, init_atom_v);
+      self->state.begin = now<microseconds>();
+      self->state.last = steady_clock::now();
+      if (current_workload() == workload::structured)
+        request_next(self, pong, make_record_batch(payload_size), timeout,
+                     round_trip);
+      else
+        request_next(self, pong, make_payload(payload_size), timeout,
+                     round_trip);
+    },
+  };
+}
+
+behavior window_ping_actor(stateful_actor<window_ping_state>* self,
+                           const actor& accumulator, const actor& collector,
+                           size_t num_pings, size_t payload_size,
+                           size_t window) {
+  using std::chrono::steady_clock;
+  self->set_exit_handler([=](const exit_msg&) { self->quit(); });
+  self->link_to(accumulator);
+  self->state.rtts.reserve(num_pings);
+  // Records the round trip of the oldest ping and returns whether to send
+  // another one in its place.
+  auto round_trip = [=] {
+    auto& st = self->state;
+    auto ts = steady_clock::now();
+    auto rtt = duration_cast<microseconds>(ts - st.in_flight.front());
+    st.rtts.emplace_back(rtt);
+    st.in_flight.pop_front();
+    if (++st.received == num_pings) {
+      self->send(accumulator, done_atom_v);
+      self->send(collector, done_atom_v, st.begin, now<microseconds>(),
+                 std::move(st.rtts));
+      return false;
+    }
+    if (st.sent == num_pings)
+      return false;
+    ++st.sent;
+    st.in_flight.emplace_back(ts);
+    return true;
+  };
+  return {
+    [=](init_atom) {
+      auto& st = self->state;
+      st.pong = actor_cast<actor>(self->current_sender());
+      self->link_to(st.pong);
+      self->send(accumulator, init_atom_v);
+      st.begin = now<microseconds>();
+      auto msg = make_workload_message(payload_size);
+      for (; st.sent < std::min(window, num_pings); ++st.sent) {
+        st.in_flight.emplace_back(steady_clock::now());
+        self->send(st.pong, msg);
+      }
+    },
+    [=](payload& p) {
+      if (round_trip())
+        self->send(self->state.pong, std::move(p));
+    },
+    [=](record_batch& xs) {
+      if (round_trip())
+        self->send(self->state.pong, std::move(xs));
+    },
+  };
+}
+
+behavior ping_dispatcher(stateful_actor<dispatcher_state>* self,
+                         const actor& accumulator, std::vector<actor> pings) {
+  self->set_exit_handler([=](const exit_msg&) { self->quit(); });
+  self->link_to(accumulator);
+  return {
+    [=](init_atom init) {
+      auto& ping = pings[self->state.next++ % pings.size()];
+      return self->delegate(ping, init);
+    },
+  };
+}
+
+behavior pong_actor(event_based_actor* self, const actor& source) {
+  self->set_exit_handler([=](const exit_msg&) { self->quit(); });
+  self->link_to(source);
+  return {
+    [=](start_atom) {
+      self->send(source, init_atom_v);
+      start_mailbox_sampling(self);
+    },
+    [=](const payload& p) { return p; },
+    [=](const record_batch& xs) { return xs; },
+    [=](probe_atom, microseconds sent) {
+      record_mailbox_probe(self, "pong", sent);
+    },
+  };
+}
+
+behavior promise_pong_actor(event_based_actor* self, const actor& source) {
+  self->set_exit_handler([=](const exit_msg&) { self->quit(); });
+  self->link_to(source);
+  return {
+    [=](start_atom) {
+      self->send(source, init_atom_v);
+      start_mailbox_sampling(self);
+    },
+    [=](payload& p) {
+      auto rp = self->make_response_promise<payload>();
+      rp.deliver(std::move(p));
+      return rp;
+    },
+    [=](record_batch& xs) {
+      auto rp = self->make_response_promise<record_batch>();
+      rp.deliver(std::move(xs));
+      return rp;
+    },
+    [=](probe_atom, microseconds sent) {
+      record_mailbox_probe(self, "pong", sent);
+    },
+  };
+}
@@ -1,7 +1,15 @@
+#include <algorithm>
+#include <atomic>
 #include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <iostream>
+#include <memory>
+#include <mutex>
 #include <string>
 #include <thread>
 #include <unistd.h>
+#include <vector>
 
 #include "caf/binary_deserializer.hpp"
 #include "caf/binary_serializer.hpp"
@@ -14,13 +22,19 @@
 #include "caf/sec.hpp"
 #include "caf/settings.hpp"
 #include "caf/span.hpp"
+#include "netem.hpp"
 #include "utility.hpp"
+#include "workload.hpp"
 
 using namespace caf;
 using namespace caf::net;
 
 using payload = std::vector<byte>;
 
+using clock_type = std::chrono::steady_clock;
+
+using std::chrono::microseconds;
+
 error send(stream_socket sock, const_byte_span payload) {
   while (!payload.empty()) {
     auto ret = write(sock, payload);
@@ -37,9 +51,9 @@ error send(stream_socket sock, const_byte_span payload) {
 error receive(stream_socket sock, byte_span buf) {
   auto data = buf.data();
   auto size = buf.size();
-  auto received = 0;
-  while (received < buf.size()) {
-    auto ret = read(sock, make_span(data, size));
+  size_t received = 0;
+  while (received < size) {
+    auto ret = read(sock, make_span(data + received, size - received));
     if (ret > 0)
       received += ret;
     else if (ret == 0)
@@ -92,15 +106,51 @@ void run_server(stream_socket sock) {
   }
 }
 
+// -- round trip statistics ----------------------------------------------------
+
+template <class T>
+T percentile(const std::vector<T>& sorted, double p) {
+  auto index = static_cast<size_t>(p * static_cast<double>(sorted.size() - 1));
+  return sorted[index];
+}
+
+/// Prints the round trips per second and the round trip percentiles in the
+/// same format as `pingpong_tcp`.
+void print_round_trips(std::vector<microseconds>& rtts,
+                       clock_type::duration elapsed) {
+  if (rtts.empty())
+    return;
+  auto seconds = std::chrono::duration<double>(elapsed).count();
+  std::cerr << "pairs, 1, " << static_cast<double>(rtts.size()) / seconds
+            << std::endl;
+  std::sort(rtts.begin(), rtts.end());
+  std::cerr << "rtt_us, " << percentile(rtts, 0.5).count() << ", "
+            << percentile(rtts, 0.9).count() << ", "
+            << percentile(rtts, 0.99).count() << ", "
+            << percentile(rtts, 0.999).count() << ", " << rtts.back().count()
+            << std::endl;
+}
+
+// -- client -------------------------------------------------------------------
+
 void run_client(stream_socket sock, size_t amount, size_t message_size) {
   send_size_t(sock, message_size);
-  payload p(message_size);
+  auto p = make_payload(message_size);
   auto receive_amount = detail::serialized_size(p);
   size_t rounds = 0;
+  auto progress = std::make_shared<std::atomic<size_t>>(0);
+  add_partial_result_dumper([progress, amount](std::ostream& out) {
+    out << "PARTIAL: " << *progress << " of " << amount << " rounds done"
+        << std::endl;
+  });
 
+  std::vector<microseconds> rtts;
+  rtts.reserve(amount);
+  auto begin = clock_type::now();
   byte_buffer send_buf;
   byte_buffer recv_buf;
   do {
+    auto sent = clock_type::now();
     binary_serializer sink{nullptr, send_buf};
     if (!sink.apply_object(p))
       exit("serializing failed", sink.get_error());
@@ -114,8 +164,76 @@ void run_client(stream_socket sock, size_t amount, size_t message_size) {
     binary_deserializer source{nullptr, recv_buf};
     if (!source.apply_object(p))
       exit("deserializing failed", sink.get_error());
-
+    rtts.emplace_back(
+      std::chrono::duration_cast<microseconds>(clock_type::now() - sent));
+    *progress = rounds + 1;
   } while (++rounds < amount);
+  print_round_trips(rtts, clock_type::now() - begin);
+}
+
+/// Keeps up to `window` pings in flight. A second thread reads the echoes,
+/// which arrive in order, and frees a slot in the window for each of them.
+void run_pipelined_client(stream_socket sock, size_t amount,
+                          size_t message_size, size_t window) {
+  send_size_t(sock, message_size);
+  auto p = make_payload(message_size);
+  auto receive_amount = detail::serialized_size(p);
+  auto progress = std::make_shared<std::atomic<size_t>>(0);
+  add_partial_result_dumper([progress, amount](std::ostream& out) {
+    out << "PARTIAL: " << *progress << " of " << amount << " rounds done"
+        << std::endl;
+  });
+  std::mutex mtx;
+  std::condition_variable cv;
+  std::deque<clock_type::time_point> in_flight;
+  std::vector<microseconds> rtts;
+  rtts.reserve(amount);
+  auto begin = clock_type::now();
+  std::thread receiver{[&] {
+    byte_buffer recv_buf(receive_amount);
+    payload echo;
+    for (size_t i = 0; i < amount; ++i) {
+      if (auto err = receive(sock, recv_buf))
+        exit("receive failed", err);
+      binary_deserializer source{nullptr, recv_buf};
+      if (!source.apply_object(echo))
+        exit("deserializing failed", source.get_error());
+      auto ts = clock_type::now();
+      {
+        std::lock_guard<std::mutex> guard{mtx};
+        rtts.emplace_back(
+          std::chrono::duration_cast<microseconds>(ts - in_flight.front()));
+        in_flight.pop_front();
+      }
+      cv.notify_one();
+      *progress = i + 1;
+    }
+  }};
+  byte_buffer send_buf;
+  for (size_t i = 0; i < amount; ++i) {
+    {
+      std::unique_lock<std::mutex> guard{mtx};
+      cv.wait(guard, [&] { return in_flight.size() < window; });
+      in_flight.emplace_back(clock_type::now());
+    }
+    send_buf.clear();
+    binary_serializer sink{nullptr, send_buf};
+    if (!sink.apply_object(p))
+      exit("serializing failed", sink.get_error());
+    if (auto err = send(sock, send_buf))
+      exit("send failed", err);
+  }
+  receiver.join();
+  print_round_trips(rtts, clock_type::now() - begin);
+}
+
+/// Runs `run_client` for a window of one and `run_pipelined_client` otherwise.
+void run_client(stream_socket sock, size_t amount, size_t message_size,
+                size_t window) {
+  if (window > 1)
+    run_pipelined_client(sock, amount, message_size, window);
+  else
+    run_client(sock, amount, message_size);
 }
 
 int main(int argc, char* argv[]) {
@@ -125,9 +243,14 @@ int main(int argc, char* argv[]) {
   bool is_server = false;
   size_t amount = 1024;
   size_t message_size = 1024;
+  size_t window = 1;
+  netem_config netem;
+  size_t deadline = 0;
+  workload_config data;
 
   int opt;
-  while ((opt = getopt(argc, argv, "h::p::sca::m::")) != -1) {
+  while ((opt = getopt(argc, argv, "h::p::sca::m::w::L::J::B::t::d::r::"))
+         != -1) {
     switch (opt) {
       case 'h':
         host = std::string(optarg);
@@ -147,11 +270,34 @@ int main(int argc, char* argv[]) {
       case 'm':
         message_size = atoi(optarg);
         break;
+      case 'w':
+        window = std::max(strtoull(optarg, nullptr, 10), 1ull);
+        break;
+      case 'L':
+        netem.latency_us = atoi(optarg);
+        break;
+      case 'J':
+        netem.jitter_us = atoi(optarg);
+        break;
+      case 'B':
+        netem.bandwidth = strtoull(optarg, nullptr, 10);
+        break;
+      case 't':
+        deadline = atoi(optarg);
+        break;
+      case 'd':
+        data.kind = std::string(optarg);
+        break;
+      case 'r':
+        data.seed = strtoull(optarg, nullptr, 10);
+        break;
       default:
         exit(EXIT_FAILURE);
     }
   }
 
+  start_watchdog(std::chrono::seconds(deadline));
+  data.apply();
   if (is_server) {
     auto sock = accept();
     if (sock.socket() == invalid_socket)
@@ -168,10 +314,11 @@ int main(int argc, char* argv[]) {
     if (auto err = nodelay(sock.socket(), true))
       exit("nodelay failed", err);
     auto start = now();
-    run_client(sock.socket(), amount, message_size);
+    run_client(sock.socket(), amount, message_size, window);
     end(start);
   } else {
-    if (auto socks = make_connected_tcp_socket_pair()) {
+    std::vector<std::unique_ptr<netem_proxy>> proxies;
+    if (auto socks = make_connected_tcp_socket_pair(netem, proxies)) {
       if (auto err = nodelay(socks->first, true))
         exit("nodelay failed", err);
       if (auto err = nodelay(socks->second, true))
@@ -181,7 +328,7 @@ int main(int argc, char* argv[]) {
       auto f = [&]() { run_server(serv_guard.socket()); };
       std::thread server_t{f};
       auto start = now();
-      run_client(client_guard.socket(), amount, message_size);
+      run_client(client_guard.socket(), amount, message_size, window);
       end(start);
       shutdown(client_guard.release());
       server_t.join();
@@ -17,11 +17,16 @@
  * http://www.boost.org/LICENSE_1_0.txt.                                      *
  ******************************************************************************/
 
+#include <algorithm>
 #include <chrono>
 #include <functional>
 #include <iostream>
+#include <memory>
+#include <numeric>
+#include <vector>
 
 #include "accumulator.hpp"
+#include "alloc_stats.hpp"
 #include "caf/actor_system_config.hpp"
 #include "caf/all.hpp"
 #include "caf/byte.hpp"
@@ -34,47 +39,18 @@
 #include "caf/net/basp/ec.hpp"
 #include "caf/net/middleman.hpp"
 #include "caf/uri.hpp"
+#include "mailbox_stats.hpp"
+#include "netem.hpp"
+#include "pingpong_actors.hpp"
 #include "type_ids.hpp"
 #include "utility.hpp"
+#include "workload.hpp"
 
 using namespace caf;
 using namespace std::chrono;
 
 namespace {
 
-using payload = std::vector<byte>;
-
-struct ping_state {
-  size_t count = 0;
-};
-
-behavior ping_actor(stateful_actor<ping_state>* self, const actor& accumulator,
-                    size_t num_pings, size_t payload_size) {
-  self->set_exit_handler([=](const exit_msg&) { self->quit(); });
-  self->link_to(accumulator);
-  return {
-    [=](init_atom) {
-      self->send(accumulator, init_atom_v);
-      payload p(payload_size);
-      return p;
-    },
-    [=](const payload& p) {
-      if (++self->state.count >= num_pings)
-        self->send(accumulator, done_atom_v);
-      return p;
-    },
-  };
-}
-
-behavior pong_actor(event_based_actor* self, const actor& source) {
-  self->set_exit_handler([=](const exit_msg&) { self->quit(); });
-  self->link_to(source);
-  return {
-    [=](start_atom) { self->send(source, init_atom_v); },
-    [=](const payload& p) { return p; },
-  };
-}
-
 struct config : actor_system_config {
   config() {
     init_global_meta_objects<caf::id_block::caf_net_benchmark>();
@@ -83,7 +59,24 @@ struct config : actor_system_config {
       .add(mode, "mode,m", "one of 'ioBench', or 'netBench'")
       .add(num_remote_nodes, "num_nodes,n", "number of remote nodes")
       .add(num_pings, "pings,p", "number of pings to exchange")
-      .add(payload_size, "size,s", "size of the exchanged payload");
+      .add(payload_size, "size,s", "size of the exchanged payload")
+      .add(actors_per_node, "actors-per-node,M",
+           "number of ping/pong pairs sharing each connection")
+      .add(deadline, "deadline", "abort the run after this many seconds")
+      .add(alloc_stats, "alloc-stats",
+           "print allocations per message and RSS to stderr")
+      .add(mailbox_sampling, "mailbox-sampling",
+           "sample mailbox depth and queueing delay every N ms")
+      .add(request_response, "request-response",
+           "send pings as requests and answer them via response promises")
+      .add(request_timeout, "request-timeout",
+           "timeout of each request in ms")
+      .add(window, "window,w", "number of pings in flight per pair")
+      .add(timed, "timed",
+           "record round trip times even for a single plain pair");
+    netem.add_options(custom_options_);
+    data.add_options(custom_options_);
+    tag_threads(*this, main_side);
     source_id = *make_uri("tcp://source");
     put(content, "caf.middleman.this-node", source_id);
     put(content, "caf.scheduler.max-threads", 1);
@@ -93,16 +86,125 @@ struct config : actor_system_config {
   size_t payload_size = 1;
   size_t num_remote_nodes = 1;
   size_t num_pings = 1024;
+  size_t actors_per_node = 1;
   std::string mode = "netBench";
+  size_t deadline = 0;
+  workload_config data;
+  bool alloc_stats = false;
+  size_t mailbox_sampling = 0;
+  bool request_response = false;
+  size_t request_timeout = 10000;
+  size_t window = 1;
+  bool timed = false;
+  netem_config netem;
+
+  /// Returns whether the pings record round trip times for the collector.
+  /// The default run sticks to the plain `ping_actor` to stay comparable
+  /// with earlier results.
+  bool timed_pings() const {
+    return timed || actors_per_node > 1 || window > 1 || request_response;
+  }
+
   uri source_id;
 };
 
-void io_run_node(uint16_t port, int sock) {
+// -- latency collection -------------------------------------------------------
+
+struct collector_state {
+  microseconds first_begin = microseconds::max();
+  microseconds last_end = microseconds::min();
+  std::vector<microseconds> pair_means;
+  std::vector<microseconds> rtts;
+};
+
+template <class T>
+T percentile(const std::vector<T>& sorted, double p) {
+  auto index = static_cast<size_t>(p * static_cast<double>(sorted.size() - 1));
+  return sorted[index];
+}
+
+/// Collects the round trip times of all `num_pairs` ping actors and prints the
+/// aggregate throughput as well as the distribution of the mean round trip
+/// time per pair, which shows how fairly the pairs share a connection.
+behavior collector_actor(stateful_actor<collector_state>* self,
+                         size_t num_pairs) {
+  return {
+    [=](done_atom, microseconds begin, microseconds end,
+        std::vector<microseconds>& rtts) {
+      auto& st = self->state;
+      st.first_begin = std::min(st.first_begin, begin);
+      st.last_end = std::max(st.last_end, end);
+      auto sum = std::accumulate(rtts.begin(), rtts.end(), microseconds{0});
+      st.pair_means.emplace_back(sum / std::max(rtts.size(), size_t{1}));
+      st.rtts.insert(st.rtts.end(), rtts.begin(), rtts.end());
+      if (st.pair_means.size() < num_pairs)
+        return;
+      std::sort(st.pair_means.begin(), st.pair_means.end());
+      std::sort(st.rtts.begin(), st.rtts.end());
+      auto wall = duration_cast<duration<double>>(st.last_end - st.first_begin);
+      std::cerr << "pairs, " << num_pairs << ", "
+                << static_cast<double>(st.rtts.size()) / wall.count()
+                << std::endl;
+      std::cerr << "pair_rtt_us, " << st.pair_means.front().count() << ", "
+                << percentile(st.pair_means, 0.5).count() << ", "
+                << percentile(st.pair_means, 0.9).count() << ", "
+                << percentile(st.pair_means, 0.99).count() << ", "
+                << st.pair_means.back().count() << std::endl;
+      if (!st.rtts.empty())
+        std::cerr << "rtt_us, " << percentile(st.rtts, 0.5).count() << ", "
+                  << percentile(st.rtts, 0.9).count() << ", "
+                  << percentile(st.rtts, 0.99).count() << ", "
+                  << percentile(st.rtts, 0.999).count() << ", "
+                  << st.rtts.back().count() << std::endl;
+      self->quit();
+    },
+  };
+}
+
+/// Spawns the ping actors for one connection. Timed runs put them behind a
+/// dispatcher, while the default run publishes a plain `ping_actor`.
+actor spawn_pings(actor_system& sys, const config& cfg,
+                  const actor& accumulator, const actor& collector) {
+  if (!cfg.timed_pings())
+    return sys.spawn(ping_actor, accumulator, cfg.num_pings, cfg.payload_size);
+  std::vector<actor> pings;
+  for (size_t i = 0; i < cfg.actors_per_node; ++i) {
+    if (cfg.window > 1)
+      pings.emplace_back(sys.spawn(window_ping_actor, accumulator, collector,
+                                   cfg.num_pings, cfg.payload_size,
+                                   cfg.window));
+    else if (cfg.request_response)
+      pings.emplace_back(sys.spawn(request_ping_actor, accumulator, collector,
+                                   cfg.num_pings, cfg.payload_size,
+                                   milliseconds(cfg.request_timeout)));
+    else
+      pings.emplace_back(sys.spawn(timed_ping_actor, accumulator, collector,
+                                   cfg.num_pings, cfg.payload_size));
+  }
+  return sys.spawn(ping_dispatcher, accumulator, std::move(pings));
+}
+
+// -- remote nodes -------------------------------------------------------------
+
+/// Spawns `num_pongs` pong actors for `source`, answering via response
+/// promises if `promises` is set.
+void spawn_pongs(actor_system& sys, const actor& source, size_t num_pongs,
+                 bool promises) {
+  for (size_t i = 0; i < num_pongs; ++i) {
+    auto pong = promises ? sys.spawn(promise_pong_actor, source)
+                         : sys.spawn(pong_actor, source);
+    anon_send(pong, start_atom_v);
+  }
+}
+
+void io_run_node(uint16_t port, int sock, size_t num_pongs, bool promises) {
+  set_alloc_side(node_side);
   actor_system_config cfg;
+  tag_threads(cfg, node_side);
   cfg.load<io::middleman>();
   if (auto err = cfg.parse(0, nullptr))
     exit("could not parse config", err);
-  put(cfg.content, "caf.scheduler.max-threads", 1);
+  apply_thread_settings(cfg);
   actor_system sys{cfg};
   using io::network::scribe_impl;
   auto& mm = sys.middleman();
@@ -115,19 +217,21 @@ void io_run_node(uint16_t port, int sock) {
       [&](node_id&, strong_actor_ptr& ptr, std::set<std::string>&) {
         if (ptr == nullptr)
           exit("could not get a handle to remote source");
-        auto sink = sys.spawn(pong_actor, actor_cast<actor>(ptr));
-        anon_send(sink, start_atom_v);
+        spawn_pongs(sys, actor_cast<actor>(ptr), num_pongs, promises);
       },
       [&](error& err) { exit("failed to resolve", err); });
 }
 
-void net_run_node(uri id, net::stream_socket sock, const uri& src_locator) {
+void net_run_node(uri id, net::stream_socket sock, const uri& src_locator,
+                  size_t num_pongs, bool promises) {
+  set_alloc_side(node_side);
   actor_system_config cfg;
+  tag_threads(cfg, node_side);
   cfg.load<net::middleman, net::backend::tcp>();
   if (auto err = cfg.parse(0, nullptr))
     exit("could not parse config", err);
   put(cfg.content, "caf.middleman.this-node", id);
-  put(cfg.content, "caf.scheduler.max-threads", 1);
+  apply_thread_settings(cfg);
   if (auto err = cfg.parse(0, nullptr))
     exit("could not parse config", err);
   actor_system sys{cfg};
@@ -139,13 +243,27 @@ void net_run_node(uri id, net::stream_socket sock, const uri& src_locator) {
   auto source = mm.remote_actor(src_locator, 2s);
   if (!source)
     exit("remote_actor failed", source.error());
-  auto sink = sys.spawn(pong_actor, *source);
-  anon_send(sink, start_atom_v);
+  spawn_pongs(sys, *source, num_pongs, promises);
 }
 
 void caf_main(actor_system& sys, const config& cfg) {
+  start_watchdog(std::chrono::seconds(cfg.deadline));
+  share_thread_settings(cfg);
+  cfg.data.apply();
+  set_mailbox_sampling(milliseconds(cfg.mailbox_sampling));
+  if (cfg.window == 0 || (cfg.window > 1 && cfg.request_response))
+    exit("window must be 1 with request-response and at least 1 otherwise");
+  set_alloc_side(main_side);
+  auto rss = cfg.alloc_stats ? std::make_unique<rss_sampler>() : nullptr;
+  std::vector<std::unique_ptr<netem_proxy>> proxies;
   std::vector<std::thread> threads;
-  auto accumulator = sys.spawn(accumulator_actor, cfg.num_remote_nodes);
+  auto num_pairs = cfg.num_remote_nodes * cfg.actors_per_node;
+  auto accumulator = sys.spawn(accumulator_actor, num_pairs);
+  // The collector only quits after hearing from every pair, so plain runs
+  // must not spawn it.
+  actor collector;
+  if (cfg.timed_pings())
+    collector = sys.spawn(collector_actor, num_pairs);
   switch (convert(cfg.mode)) {
     case bench_mode::io: {
       std::cerr << "run in 'ioBench' mode" << std::endl;
@@ -154,13 +272,17 @@ void caf_main(actor_system& sys, const config& cfg) {
       auto& mpx = dynamic_cast<io::network::default_multiplexer&>(mm.backend());
       auto bb = mm.named_broker<io::basp_broker>("BASP");
       for (size_t port = 0; port < cfg.num_remote_nodes; ++port) {
-        auto src = sys.spawn(ping_actor, accumulator, cfg.num_pings,
-                             cfg.payload_size);
-        auto p = *net::make_stream_socket_pair();
+        auto src = spawn_pings(sys, cfg, accumulator, collector);
+        auto p = cfg.netem.enabled()
+                   ? *make_connected_tcp_socket_pair(cfg.netem, proxies)
+                   : *net::make_stream_socket_pair();
         io::scribe_ptr scribe = make_counted<scribe_impl>(mpx, p.first.id);
         anon_send(bb, publish_atom_v, std::move(scribe), uint16_t(8080 + port),
                   actor_cast<strong_actor_ptr>(src), std::set<std::string>{});
-        auto f = [=]() { io_run_node(port, p.second.id); };
+        auto f = [=, &cfg]() {
+          io_run_node(port, p.second.id, cfg.actors_per_node,
+                      cfg.request_response);
+        };
         threads.emplace_back(f);
       }
       break;
@@ -170,15 +292,17 @@ void caf_main(actor_system& sys, const config& cfg) {
       auto& mm = sys.network_manager();
       auto& backend = *dynamic_cast<net::backend::tcp*>(mm.backend("tcp"));
       for (size_t i = 0; i < cfg.num_remote_nodes; ++i) {
-        auto src = sys.spawn(ping_actor, accumulator, cfg.num_pings,
-                             cfg.payload_size);
+        auto src = spawn_pings(sys, cfg, accumulator, collector);
         mm.publish(src, std::string("source-") + std::to_string(i));
         auto src_locator = *make_uri(std::string("tcp://source/name/source-")
                                      + std::to_string(i));
-        auto p = *make_connected_tcp_socket_pair();
+        auto p = *make_connected_tcp_socket_pair(cfg.netem, proxies);
         auto sink_id = *make_uri(std::string("tcp://sink") + std::to_string(i));
         backend.emplace(make_node_id(sink_id), p.first);
-        auto f = [=]() { net_run_node(sink_id, p.second, src_locator); };
+        auto f = [=, &cfg]() {
+          net_run_node(sink_id, p.second, src_locator, cfg.actors_per_node,
+                       cfg.request_response);
+        };
         threads.emplace_back(f);
       }
       break;
@@ -188,6 +312,12 @@ void caf_main(actor_system& sys, const config& cfg) {
   }
   for (auto& t : threads)
     t.join();
+  if (rss) {
+    print_alloc_stats(std::cerr, num_pairs * cfg.num_pings);
+    print_rss_stats(std::cerr, *rss);
+  }
+  if (mailbox_sampling_enabled())
+    print_mailbox_stats(std::cerr);
   std::cerr << std::endl;
 }
 
@@ -17,10 +17,13 @@
  * http://www.boost.org/LICENSE_1_0.txt.                                      *
  ******************************************************************************/
 
+#include <algorithm>
 #include <chrono>
 #include <functional>
 #include <iostream>
+#include <map>
 #include <thread>
+#include <vector>
 
 #include "accumulator.hpp"
 #include "caf/actor_system_config.hpp"
@@ -36,8 +39,10 @@
 #include "caf/net/socket_guard.hpp"
 #include "caf/net/udp_datagram_socket.hpp"
 #include "caf/uri.hpp"
+#include "netem.hpp"
 #include "type_ids.hpp"
 #include "utility.hpp"
+#include "workload.hpp"
 
 using namespace caf;
 using namespace std::chrono;
@@ -46,24 +51,147 @@ namespace {
 
 using payload = std::vector<caf::byte>;
 
+// Every ping carries a sequence number and its send time, which the pong
+// echoes back. A ping without an echo after `timeout` goes out again, up to
+// `retries` times, before it counts as lost. This keeps the run going on
+// lossy links and accounts for every datagram:
+//
+// - lost: pings without an echo after all retries
+// - retransmits: pings sent again after a timeout
+// - duplicates: echoes for pings that were already answered
+// - late: echoes for pings that already counted as lost
+// - reordered: echoes that arrived after an echo with a higher number, with
+//   the largest difference as the reorder depth
+
+microseconds steady_now() {
+  return duration_cast<microseconds>(steady_clock::now().time_since_epoch());
+}
+
+template <class T>
+T percentile(const std::vector<T>& sorted, double p) {
+  auto index = static_cast<size_t>(p * static_cast<double>(sorted.size() - 1));
+  return sorted[index];
+}
+
+struct ping_settings {
+  size_t num_pings = 0;
+  size_t payload_size = 0;
+  size_t window = 1;
+  milliseconds timeout{100};
+  size_t retries = 10;
+};
+
 struct ping_state {
-  size_t count = 0;
+  actor pong;
+  payload prototype;
+  uint64_t next_seq = 0;
+  /// Sequence numbers in flight and the attempt they are at.
+  std::map<uint64_t, size_t> pending;
+  std::vector<bool> answered;
+  uint64_t highest = 0;
+  size_t received = 0;
+  size_t lost = 0;
+  size_t retransmits = 0;
+  size_t duplicates = 0;
+  size_t late = 0;
+  size_t reordered = 0;
+  uint64_t max_reorder_depth = 0;
+  std::vector<microseconds> rtts;
 };
 
-behavior ping_actor(stateful_actor<ping_state>* self, const actor& accumulator,
-                    size_t num_pings, size_t payload_size) {
+using ping_actor_type = stateful_actor<ping_state>;
+
+void transmit(ping_actor_type* self, const ping_settings& cfg, uint64_t seq,
+              size_t attempt) {
+  self->state.pending[seq] = attempt;
+  self->send(self->state.pong, seq, steady_now(), self->state.prototype);
+  self->delayed_send(self, cfg.timeout, retransmit_atom_v, seq, attempt);
+}
+
+void print_ping_stats(ping_state& st, size_t num_pings) {
+  auto loss_rate = static_cast<double>(st.lost)
+                   / static_cast<double>(std::max(num_pings, size_t{1}));
+  std::cerr << "udp_pings, " << num_pings << ", " << st.received << ", "
+            << st.lost << ", " << loss_rate << ", " << st.retransmits << ", "
+            << st.duplicates << ", " << st.late << ", " << st.reordered
+            << ", " << st.max_reorder_depth << std::endl;
+  auto& xs = st.rtts;
+  if (xs.empty())
+    return;
+  std::sort(xs.begin(), xs.end());
+  std::cerr << "rtt_us, " << percentile(xs, 0.5).count() << ", "
+            << percentile(xs, 0.9).count() << ", "
+            << percentile(xs, 0.99).count() << ", "
+            << percentile(xs, 0.999).count() << ", " << xs.back().count()
+            << std::endl;
+}
+
+/// Sends the next new ping or finishes the run once no ping is in flight.
+void advance(ping_actor_type* self, const actor& accumulator,
+             const ping_settings& cfg) {
+  auto& st = self->state;
+  if (st.next_seq < cfg.num_pings) {
+    transmit(self, cfg, st.next_seq++, 1);
+  } else if (st.pending.empty()) {
+    print_ping_stats(st, cfg.num_pings);
+    self->send(accumulator, done_atom_v);
+  }
+}
+
+/// Keeps up to `cfg.window` numbered pings in flight to the pong that sent
+/// `init_atom` and retransmits pings that time out.
+behavior ping_actor(ping_actor_type* self, const actor& accumulator,
+                    ping_settings cfg) {
   self->set_exit_handler([=](const exit_msg&) { self->quit(); });
   self->link_to(accumulator);
+  self->state.answered.resize(cfg.num_pings);
+  self->state.rtts.reserve(cfg.num_pings);
   return {
     [=](init_atom) {
+      auto& st = self->state;
+      st.pong = actor_cast<actor>(self->current_sender());
+      st.prototype = make_payload(cfg.payload_size);
       self->send(accumulator, init_atom_v);
-      payload p(payload_size);
-      return p;
+      for (size_t i = 0; i < cfg.window && st.next_seq < cfg.num_pings; ++i)
+        advance(self, accumulator, cfg);
+    },
+    [=](uint64_t seq, microseconds sent, const payload&) {
+      auto& st = self->state;
+      if (seq >= cfg.num_pings)
+        return;
+      if (st.answered[seq]) {
+        ++st.duplicates;
+        return;
+      }
+      st.answered[seq] = true;
+      if (st.pending.erase(seq) == 0) {
+        ++st.late;
+        return;
+      }
+      ++st.received;
+      st.rtts.emplace_back(steady_now() - sent);
+      if (seq < st.highest) {
+        ++st.reordered;
+        st.max_reorder_depth = std::max(st.max_reorder_depth,
+                                        st.highest - seq);
+      } else {
+        st.highest = seq;
+      }
+      advance(self, accumulator, cfg);
     },
-    [=](const payload& p) {
-      if (++self->state.count >= num_pings)
-        self->send(accumulator, done_atom_v);
-      return p;
+    [=](retransmit_atom, uint64_t seq, size_t attempt) {
+      auto& st = self->state;
+      auto i = st.pending.find(seq);
+      if (i == st.pending.end() || i->second != attempt)
+        return;
+      if (attempt <= cfg.retries) {
+        ++st.retransmits;
+        transmit(self, cfg, seq, attempt + 1);
+      } else {
+        st.pending.erase(i);
+        ++st.lost;
+        advance(self, accumulator, cfg);
+      }
     },
   };
 }
@@ -73,9 +201,12 @@ behavior pong_actor(event_based_actor* self, const actor& source) {
   self->link_to(source);
   return {
     [=](start_atom) { self->send(source, init_atom_v); },
-    [=](const payload& p) { return p; },
+    [=](uint64_t seq, microseconds sent, const payload& p) {
+      return make_message(seq, sent, p);
+    },
   };
 }
+
 struct config : actor_system_config {
   config() {
     init_global_meta_objects<caf::id_block::caf_net_benchmark>();
@@ -83,7 +214,13 @@ struct config : actor_system_config {
     opt_group{custom_options_, "global"}
       .add(num_remote_nodes, "num_nodes,n", "number of remote nodes")
       .add(num_pings, "pings,p", "number of pings to exchange")
-      .add(payload_size, "size,s", "size of the exchanged payload");
+      .add(payload_size, "size,s", "size of the exchanged payload")
+      .add(window, "window,w", "number of pings in flight per node")
+      .add(timeout, "timeout", "retransmit a ping after this many ms")
+      .add(retries, "retries", "retransmits before a ping counts as lost")
+      .add(deadline, "deadline", "abort the run after this many seconds");
+    netem.add_options(custom_options_);
+    data.add_options(custom_options_);
     put(content, "caf.middleman.this-node", this_node);
     put(content, "caf.scheduler.max-threads", 1);
     load<net::middleman, net::backend::udp>();
@@ -92,10 +229,17 @@ struct config : actor_system_config {
   size_t payload_size = 1;
   size_t num_remote_nodes = 1;
   size_t num_pings = 1024;
+  size_t window = 1;
+  size_t timeout = 100;
+  size_t retries = 10;
+  size_t deadline = 0;
+  workload_config data;
+  netem_config netem;
   uri this_node;
 };
 
 void net_run_source_node(uri this_node, const std::string& remote_str,
+                         const std::string& ping_name,
                          net::udp_datagram_socket sock, uint16_t port) {
   std::cerr << "net_run_source_node thread started! " << std::endl;
   std::cerr << "thread got socket " << sock.id << std::endl;
@@ -106,7 +250,7 @@ void net_run_source_node(uri this_node, const std::string& remote_str,
   if (auto err = cfg.parse(0, nullptr))
     exit("thread could not parse config 1: ", err);
   put(cfg.content, "caf.middleman.this-node", this_node);
-  put(cfg.content, "caf.scheduler.max-threads", 1);
+  apply_thread_settings(cfg);
   std::cerr << "pong_node " << to_string(this_node) << std::endl;
   if (auto err = cfg.parse(0, nullptr))
     exit("thread could not parse config 2: ", err);
@@ -118,7 +262,7 @@ void net_run_source_node(uri this_node, const std::string& remote_str,
   auto ret = backend.emplace(sock, port);
   if (!ret)
     exit("thread backend.emplace failed: ", ret.error());
-  auto remote_locator = make_uri(remote_str + "/name/ping");
+  auto remote_locator = make_uri(remote_str + "/name/" + ping_name);
   if (!remote_locator)
     exit("thread make_uri failed: ", remote_locator.error());
   auto source = mm.remote_actor(*remote_locator, 2s);
@@ -129,6 +273,9 @@ void net_run_source_node(uri this_node, const std::string& remote_str,
 }
 
 void caf_main(actor_system&, const config& args) {
+  start_watchdog(std::chrono::seconds(args.deadline));
+  share_thread_settings(args);
+  args.data.apply();
   ip_endpoint ep;
   auto addrs = net::ip::local_addresses("localhost");
   if (addrs.empty())
@@ -151,6 +298,7 @@ void caf_main(actor_system&, const config& args) {
   if (auto err = cfg.parse(0, nullptr))
     exit("main, could not parse config 1", err);
   put(cfg.content, "caf.middleman.this-node", *this_node);
+  apply_thread_settings(cfg);
   if (auto err = cfg.parse(0, nullptr))
     exit("main, could not parse config 2", err);
   actor_system sys{cfg};
@@ -162,11 +310,21 @@ void caf_main(actor_system&, const config& args) {
   if (!err)
     exit("main backend.emplace() failed: ", err.error());
   auto accumulator = sys.spawn(accumulator_actor, args.num_remote_nodes);
-  auto ping = sys.spawn(ping_actor, accumulator, args.num_pings,
-                        args.payload_size);
-  mm.publish(ping, "ping");
+  ping_settings settings;
+  settings.num_pings = args.num_pings;
+  settings.payload_size = args.payload_size;
+  settings.window = std::max(args.window, size_t{1});
+  settings.timeout = milliseconds(args.timeout);
+  settings.retries = args.retries;
+  // Each remote node gets its own ping, since pings pair with the first pong
+  // that greets them.
+  for (size_t i = 0; i < args.num_remote_nodes; ++i)
+    mm.publish(sys.spawn(ping_actor, accumulator, settings),
+               "ping" + std::to_string(i));
   std::this_thread::sleep_for(500ms);
   std::vector<std::thread> threads;
+  std::vector<std::unique_ptr<netem_proxy>> proxies;
+  ip_endpoint this_ep{addrs.front(), port};
   std::cerr << "starting remote node now!" << std::endl;
   std::vector<net::socket_guard<net::udp_datagram_socket>> sockets;
   for (size_t i = 0; i < args.num_remote_nodes; ++i) {
@@ -184,13 +342,28 @@ void caf_main(actor_system&, const config& args) {
     std::cerr << "ping_id = " << to_string(*this_node)
               << " pong_id = " << to_string(*pong_id) << std::endl;
     std::cerr << "main passing to thread socket " << sock.id << std::endl;
-    auto f = [pong_id = *pong_id, this_node_str, sock = sock, port = port]() {
-      net_run_source_node(pong_id, this_node_str, sock, port);
+    auto remote_str = this_node_str;
+    if (args.netem.enabled()) {
+      // Let the remote node talk to this node through an emulated link.
+      auto proxy = std::make_unique<netem_udp_proxy>(args.netem);
+      auto proxy_port = proxy->start(this_ep);
+      if (!proxy_port)
+        exit("main starting netem proxy failed", proxy_port.error());
+      remote_str = "udp://" + to_string(addrs.front()) + ":"
+                   + std::to_string(*proxy_port);
+      proxies.emplace_back(std::move(proxy));
+    }
+    auto f = [pong_id = *pong_id, remote_str, sock = sock, port = port,
+              ping_name = "ping" + std::to_string(i)]() {
+      net_run_source_node(pong_id, remote_str, ping_name, sock, port);
     };
     threads.emplace_back(f);
   }
   for (auto& t : threads)
     t.join();
+  for (auto& proxy : proxies)
+    if (auto failed = proxy->stats().failed_packets.load(); failed > 0)
+      std::cerr << "netem, failed_packets, " << failed << std::endl;
   std::cerr << std::endl;
 }
 
@@ -0,0 +1,30 @@
+#include "pooled_payload.hpp"
+
+void pooled_payload::releaser::operator()(buffer_type* ptr) const {
+  buffer_pool::instance().release(std::unique_ptr<buffer_type>{ptr});
+}
+
+pooled_payload::pooled_payload(size_t size) {
+  buffer().resize(size);
+}
+
+pooled_payload::pooled_payload(const pooled_payload& other) {
+  if (other.buf_)
+    buffer() = *other.buf_;
+}
+
+pooled_payload& pooled_payload::operator=(const pooled_payload& other) {
+  if (this != &other) {
+    if (other.buf_)
+      buffer() = *other.buf_;
+    else
+      buf_.reset();
+  }
+  return *this;
+}
+
+pooled_payload::buffer_type& pooled_payload::buffer() {
+  if (buf_ == nullptr)
+    buf_.reset(buffer_pool::instance().acquire().release());
+  return *buf_;
+}
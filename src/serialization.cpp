@@ -0,0 +1,183 @@
+/******************************************************************************
+ *                       ____    _    _____                                   *
+ *                      / ___|  / \  |  ___|    C++                           *
+ *                     | |     / _ \ | |_       Actor                         *
+ *                     | |___ / ___ \|  _|      Framework                     *
+ *                      \____/_/   \_|_|                                      *
+ *                                                                            *
+ * Copyright (C) 2011 - 2020                                                  *
+ * Jakob Otto <jakob.otto (at) haw-hamburg.de>                                *
+ *                                                                            *
+ * Distributed under the terms and conditions of the BSD 3-Clause License or  *
+ * (at your option) under the terms and conditions of the Boost Software      *
+ * License 1.0. See accompanying files LICENSE and LICENCE_ALTERNATIVE.       *
+ *                                                                            *
+ * If you did not receive a copy of the license files, see                    *
+ * http://opensource.org/licenses/BSD-3-Clause and                            *
+ * http://www.boost.org/LICENSE_1_0.txt.                                      *
+ ******************************************************************************/
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+#include "caf/binary_deserializer.hpp"
+#include "caf/binary_serializer.hpp"
+#include "caf/byte.hpp"
+#include "caf/byte_buffer.hpp"
+#include "caf/detail/serialized_size.hpp"
+#include "caf/span.hpp"
+#include "bulk_payload.hpp"
+#include "utility.hpp"
+#include "workload.hpp"
+
+using namespace caf;
+using namespace std::chrono;
+
+namespace {
+
+using clock_type = std::chrono::steady_clock;
+
+/// Throughput of one operation in MiB/s.
+double mib_per_second(size_t bytes, size_t iterations, nanoseconds duration) {
+  if (duration.count() == 0)
+    return 0.0;
+  auto total = static_cast<double>(bytes) * static_cast<double>(iterations);
+  return (total / (1024.0 * 1024.0))
+         / duration_cast<duration<double>>(duration).count();
+}
+
+/// Tells the compiler that `ptr` escapes and memory may be read, so it cannot
+/// drop or hoist out of the loop a copy whose result nobody reads.
+void escape(void* ptr) {
+  asm volatile("" : : "g"(ptr) : "memory");
+}
+
+/// Caps the number of repetitions for tiny values.
+constexpr size_t max_iterations = 10'000'000;
+
+/// Repeats `f` until it ran at least `min_iterations` times and touched at
+/// least `min_bytes` bytes, then returns the total time.
+template <class F>
+std::pair<size_t, nanoseconds>
+measure(size_t bytes, size_t min_bytes, size_t min_iterations, F f) {
+  auto iterations = std::min(min_bytes / std::max(bytes, size_t{1}),
+                             max_iterations);
+  iterations = std::max(iterations, min_iterations);
+  auto begin = clock_type::now();
+  for (size_t i = 0; i < iterations; ++i)
+    f();
+  return {iterations, duration_cast<nanoseconds>(clock_type::now() - begin)};
+}
+
+/// Measures serializing and deserializing `value` and prints one CSV row. The
+/// first three rates refer to the size of the value, the last three to its
+/// serialized size.
+template <class T>
+void run(const std::string& name, size_t size, const T& value,
+         size_t min_bytes, size_t min_iterations) {
+  byte_buffer buf;
+  buf.reserve(detail::serialized_size(value));
+  auto [ser_iterations, ser_time]
+    = measure(size, min_bytes, min_iterations, [&] {
+        buf.clear();
+        binary_serializer sink{nullptr, buf};
+        if (!sink.apply_object(value))
+          exit("serializing failed", sink.get_error());
+      });
+  T result;
+  auto [deser_iterations, deser_time]
+    = measure(size, min_bytes, min_iterations, [&] {
+        binary_deserializer source{nullptr, buf};
+        if (!source.apply_object(result))
+          exit("deserializing failed", source.get_error());
+      });
+  // The memcpy baseline copies the serialized representation once.
+  byte_buffer copy(buf.size());
+  auto [copy_iterations, copy_time]
+    = measure(size, min_bytes, min_iterations,
+              [&] {
+                std::memcpy(copy.data(), buf.data(), buf.size());
+                escape(copy.data());
+              });
+  if (copy.size() > 0 && copy.front() != buf.front())
+    exit("memcpy baseline produced different data");
+  auto wire = buf.size();
+  std::cout << name << ", " << size << ", " << wire << ", "
+            << mib_per_second(size, ser_iterations, ser_time) << ", "
+            << mib_per_second(size, deser_iterations, deser_time) << ", "
+            << mib_per_second(size, copy_iterations, copy_time) << ", "
+            << mib_per_second(wire, ser_iterations, ser_time) << ", "
+            << mib_per_second(wire, deser_iterations, deser_time) << ", "
+            << mib_per_second(wire, copy_iterations, copy_time) << std::endl;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+  size_t min_size = 1;
+  size_t max_size = 16 * 1024 * 1024;
+  size_t min_bytes = 256 * 1024 * 1024;
+  size_t min_iterations = 10;
+  size_t deadline = 0;
+  workload_config data;
+
+  int opt;
+  while ((opt = getopt(argc, argv, "s::m::b::i::t::d::r::")) != -1) {
+    switch (opt) {
+      case 's':
+        min_size = strtoull(optarg, nullptr, 10);
+        break;
+      case 'm':
+        max_size = strtoull(optarg, nullptr, 10);
+        break;
+      case 'b':
+        min_bytes = strtoull(optarg, nullptr, 10);
+        break;
+      case 'i':
+        min_iterations = strtoull(optarg, nullptr, 10);
+        break;
+      case 't':
+        deadline = atoi(optarg);
+        break;
+      case 'd':
+        data.kind = std::string(optarg);
+        break;
+      case 'r':
+        data.seed = strtoull(optarg, nullptr, 10);
+        break;
+      default:
+        fprintf(stderr,
+                "Usage: %s [-s<min>] [-m<max>] [-b<bytes>] [-i<n>] "
+                "[-d<data>] [-r<seed>]\n",
+                argv[0]);
+        exit(EXIT_FAILURE);
+    }
+  }
+  start_watchdog(std::chrono::seconds(deadline));
+  data.apply();
+  std::cout << "type, size, serialized_size, serialize_mib_s, "
+               "deserialize_mib_s, memcpy_mib_s, serialize_wire_mib_s, "
+               "deserialize_wire_mib_s, memcpy_wire_mib_s"
+            << std::endl;
+  run("byte", sizeof(byte), byte{42}, min_bytes, min_iterations);
+  run("microseconds", sizeof(microseconds), microseconds(42), min_bytes,
+      min_iterations);
+  for (auto size = std::max(min_size, size_t{1}); size <= max_size; size *= 2) {
+    run("vector<byte>", size, make_payload(size), min_bytes, min_iterations);
+    run("bulk_payload", size, bulk_payload(make_payload(size)), min_bytes,
+        min_iterations);
+    if (current_workload() == workload::structured)
+      run("record_batch", size, make_record_batch(size), min_bytes,
+          min_iterations);
+    if (size >= sizeof(microseconds)) {
+      std::vector<microseconds> timestamps(size / sizeof(microseconds));
+      run("vector<microseconds>", size, timestamps, min_bytes, min_iterations);
+    }
+  }
+  return 0;
+}
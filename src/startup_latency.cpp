@@ -0,0 +1,244 @@
+/******************************************************************************
+ *                       ____    _    _____                                   *
+ *                      / ___|  / \  |  ___|    C++                           *
+ *                     | |     / _ \ | |_       Actor                         *
+ *                     | |___ / ___ \|  _|      Framework                     *
+ *                      \____/_/   \_|_|                                      *
+ *                                                                            *
+ * Copyright (C) 2011 - 2020                                                  *
+ * Jakob Otto <jakob.otto (at) haw-hamburg.de>                                *
+ *                                                                            *
+ * Distributed under the terms and conditions of the BSD 3-Clause License or  *
+ * (at your option) under the terms and conditions of the Boost Software      *
+ * License 1.0. See accompanying files LICENSE and LICENCE_ALTERNATIVE.       *
+ *                                                                            *
+ * If you did not receive a copy of the license files, see                    *
+ * http://opensource.org/licenses/BSD-3-Clause and                            *
+ * http://www.boost.org/LICENSE_1_0.txt.                                      *
+ ******************************************************************************/
+
+// Measures how long a fresh node takes to join an existing actor system. Each
+// repetition constructs a new actor system, hands it a connected TCP socket,
+// resolves a published actor on the other side and shuts the system down
+// again. The phases are timed separately:
+//
+// - system_us: configuring and constructing the actor system
+// - emplace_us: registering the socket with the multiplexer, i.e.,
+//   `backend.emplace` for net and creating the scribe for io
+// - handshake_us: resolving the first actor, which includes the BASP
+//   handshake (`remote_actor` for net, `connect_atom` for io)
+// - resolve_us: resolving a second actor over the established connection
+//   (`remote_actor` for net, `remote_lookup` for io)
+// - teardown_us: destroying the actor system
+//
+// The output is one row per repetition. The first repetition also pays for
+// lazily initialized state in the process and usually stands out.
+
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include <set>
+#include <string>
+
+#include "caf/actor_system_config.hpp"
+#include "caf/all.hpp"
+#include "caf/defaults.hpp"
+#include "caf/io/all.hpp"
+#include "caf/io/network/default_multiplexer.hpp"
+#include "caf/io/network/scribe_impl.hpp"
+#include "caf/io/scribe.hpp"
+#include "caf/net/backend/tcp.hpp"
+#include "caf/net/middleman.hpp"
+#include "caf/net/stream_socket.hpp"
+#include "caf/uri.hpp"
+#include "type_ids.hpp"
+#include "utility.hpp"
+
+using namespace caf;
+using namespace std::chrono;
+
+namespace {
+
+using clock_type = std::chrono::steady_clock;
+
+struct config : actor_system_config {
+  config() {
+    init_global_meta_objects<caf::id_block::caf_net_benchmark>();
+    io::middleman::init_global_meta_objects();
+    opt_group{custom_options_, "global"}
+      .add(mode, "mode,m", "one of 'ioBench', or 'netBench'")
+      .add(repetitions, "repetitions,r", "number of nodes joining in a row")
+      .add(deadline, "deadline", "abort the run after this many seconds");
+    earth_id = *make_uri("tcp://earth");
+    put(content, "caf.middleman.this-node", earth_id);
+    put(content, "caf.scheduler.max-threads", 1);
+    load<net::middleman, net::backend::tcp>();
+  }
+
+  std::string mode = "netBench";
+  size_t repetitions = 100;
+  size_t deadline = 0;
+  uri earth_id;
+};
+
+struct phase_times {
+  microseconds system{0};
+  microseconds emplace{0};
+  microseconds handshake{0};
+  microseconds resolve{0};
+  microseconds teardown{0};
+};
+
+/// Measures the time between construction and each call to `next`.
+class stopwatch {
+public:
+  stopwatch() : last_(clock_type::now()) {
+    // nop
+  }
+
+  microseconds next() {
+    auto now = clock_type::now();
+    auto result = duration_cast<microseconds>(now - last_);
+    last_ = now;
+    return result;
+  }
+
+private:
+  clock_type::time_point last_;
+};
+
+/// Calls `parse` on a fresh config, which fills in the defaults of all loaded
+/// modules.
+void parse_node_config(actor_system_config& cfg) {
+  if (auto err = cfg.parse(0, nullptr))
+    exit("could not parse config", err);
+  apply_thread_settings(cfg);
+  if (auto err = cfg.parse(0, nullptr))
+    exit("could not parse config", err);
+}
+
+// -- io -----------------------------------------------------------------------
+
+phase_times io_join(net::stream_socket sock, uint16_t port) {
+  phase_times result;
+  stopwatch watch;
+  actor_system_config cfg;
+  cfg.load<io::middleman>();
+  parse_node_config(cfg);
+  auto sys = std::make_unique<actor_system>(cfg);
+  result.system = watch.next();
+  {
+    using io::network::scribe_impl;
+    auto& mm = sys->middleman();
+    auto& mpx = dynamic_cast<io::network::default_multiplexer&>(mm.backend());
+    io::scribe_ptr scribe = make_counted<scribe_impl>(mpx, sock.id);
+    auto bb = mm.named_broker<io::basp_broker>("BASP");
+    result.emplace = watch.next();
+    node_id peer;
+    scoped_actor self{*sys};
+    self->request(bb, infinite, connect_atom_v, std::move(scribe), port)
+      .receive(
+        [&](node_id& nid, strong_actor_ptr& ptr, std::set<std::string>&) {
+          if (ptr == nullptr)
+            exit("could not get a handle to the published actor");
+          peer = std::move(nid);
+        },
+        [&](error& err) { exit("connect failed", err); });
+    result.handshake = watch.next();
+    if (mm.remote_lookup("second", peer) == nullptr)
+      exit("remote_lookup failed");
+    result.resolve = watch.next();
+  }
+  sys.reset();
+  result.teardown = watch.next();
+  return result;
+}
+
+// -- net ----------------------------------------------------------------------
+
+phase_times net_join(net::stream_socket sock, const uri& id) {
+  phase_times result;
+  stopwatch watch;
+  actor_system_config cfg;
+  cfg.load<net::middleman, net::backend::tcp>();
+  put(cfg.content, "caf.middleman.this-node", id);
+  parse_node_config(cfg);
+  auto sys = std::make_unique<actor_system>(cfg);
+  result.system = watch.next();
+  {
+    auto& mm = sys->network_manager();
+    auto& backend = *dynamic_cast<net::backend::tcp*>(mm.backend("tcp"));
+    auto ret = backend.emplace(make_node_id(*make_uri("tcp://earth")), sock);
+    if (!ret)
+      exit("emplace failed", ret.error());
+    result.emplace = watch.next();
+    auto first = mm.remote_actor(*make_uri("tcp://earth/name/first"), 2s);
+    if (!first)
+      exit("remote_actor failed", first.error());
+    result.handshake = watch.next();
+    auto second = mm.remote_actor(*make_uri("tcp://earth/name/second"), 2s);
+    if (!second)
+      exit("remote_actor failed", second.error());
+    result.resolve = watch.next();
+  }
+  sys.reset();
+  result.teardown = watch.next();
+  return result;
+}
+
+void caf_main(actor_system& sys, const config& cfg) {
+  start_watchdog(std::chrono::seconds(cfg.deadline));
+  share_thread_settings(cfg);
+  auto mode = convert(cfg.mode);
+  if (mode != bench_mode::io && mode != bench_mode::net)
+    exit(std::string("invalid mode: \"") + cfg.mode + "\"");
+  // Both targets simply stay alive until the end of the benchmark.
+  auto idle = [](event_based_actor* self) {
+    self->set_default_handler(drop);
+    return behavior{[](done_atom) {}};
+  };
+  auto first = sys.spawn(idle);
+  auto second = sys.spawn(idle);
+  sys.registry().put(std::string("first"), first);
+  sys.registry().put(std::string("second"), second);
+  std::cout << "mode, rep, system_us, emplace_us, handshake_us, resolve_us, "
+               "teardown_us"
+            << std::endl;
+  for (size_t rep = 0; rep < cfg.repetitions; ++rep) {
+    auto sockets = make_connected_tcp_socket_pair();
+    if (!sockets)
+      exit("connecting the sockets failed", sockets.error());
+    phase_times times;
+    if (mode == bench_mode::io) {
+      using io::network::scribe_impl;
+      auto& mm = sys.middleman();
+      auto& mpx = dynamic_cast<io::network::default_multiplexer&>(mm.backend());
+      auto bb = mm.named_broker<io::basp_broker>("BASP");
+      auto port = static_cast<uint16_t>(8080 + rep % 1000);
+      io::scribe_ptr scribe = make_counted<scribe_impl>(mpx,
+                                                        sockets->first.id);
+      anon_send(bb, publish_atom_v, std::move(scribe), port,
+                actor_cast<strong_actor_ptr>(first), std::set<std::string>{});
+      times = io_join(sockets->second, port);
+    } else {
+      // Every joining node gets a fresh ID, otherwise the backend would route
+      // to the connection of a previous repetition.
+      auto id = *make_uri("tcp://node" + std::to_string(rep));
+      auto& mm = sys.network_manager();
+      auto& backend = *dynamic_cast<net::backend::tcp*>(mm.backend("tcp"));
+      if (auto ret = backend.emplace(make_node_id(id), sockets->first); !ret)
+        exit("emplace failed", ret.error());
+      times = net_join(sockets->second, id);
+    }
+    std::cout << cfg.mode << ", " << rep << ", " << times.system.count()
+              << ", " << times.emplace.count() << ", "
+              << times.handshake.count() << ", " << times.resolve.count()
+              << ", " << times.teardown.count() << std::endl;
+  }
+  anon_send_exit(first, exit_reason::user_shutdown);
+  anon_send_exit(second, exit_reason::user_shutdown);
+}
+
+} // namespace
+
+CAF_MAIN(io::middleman)
@@ -0,0 +1,135 @@
+#include "streaming_actors.hpp"
+
+#include <algorithm>
+#include <chrono>
+
+#include "caf/behavior.hpp"
+#include "caf/event_based_actor.hpp"
+#include "caf/exit_reason.hpp"
+#include "caf/message.hpp"
+#include "caf/stateful_actor.hpp"
+#include "compressed_payload.hpp"
+#include "mailbox_stats.hpp"
+#include "type_ids.hpp"
+
+using namespace caf;
+using std::chrono::microseconds;
+
+// -- source actor -------------------------------------------------------------
+
+void source_state::fill_payloads(size_t byte_amount, size_t message_size) {
+  auto structured = current_workload() == workload::structured;
+  while (byte_amount > 0) {
+    auto size = std::min(byte_amount, message_size);
+    if (structured)
+      records.emplace_back(make_record_batch(size, records.size()));
+    else
+      payloads.emplace_back(make_payload(size, payloads.size()));
+    byte_amount -= size;
+  }
+}
+
+size_t source_state::send_next(event_based_actor* self, const actor& sink,
+                                size_t batch_size) {
+  if (!records.empty()) {
+    auto& xs = records[next++];
+    auto size = xs.size();
+    self->send(sink, std::move(xs));
+    return size;
+  }
+  if (batch_size <= 1) {
+    auto& p = payloads[next++];
+    auto size = p.size();
+    if (compression_enabled())
+      self->send(sink, compressed_payload{std::move(p)});
+    else
+      self->send(sink, std::move(p));
+    return size;
+  }
+  auto n = std::min(batch_size, payloads.size() - next);
+  std::vector<payload> batch;
+  batch.reserve(n);
+  size_t size = 0;
+  for (size_t i = 0; i < n; ++i) {
+    size += payloads[next].size();
+    batch.emplace_back(std::move(payloads[next++]));
+  }
+  self->send(sink, std::move(batch));
+  return size;
+}
+
+behavior source_actor(stateful_actor<source_state>* self, actor sink,
+                      size_t streaming_amount, size_t message_size,
+                      size_t batch_size) {
+  self->set_exit_handler([=](const exit_msg&) { self->quit(); });
+  self->link_to(sink);
+  return {
+    [=](init_atom init) {
+      self->state.fill_payloads(streaming_amount, message_size);
+      self->send(sink, init, streaming_amount);
+    },
+    [=](send_atom) {
+      auto& st = self->state;
+      while (!st.done())
+        st.send_next(self, sink, batch_size);
+    },
+    [=](credit_atom, size_t amount, bool in_bytes) {
+      // The credit may drop below zero if a byte window is smaller than a
+      // message, which then only delays the next send. Message credit counts
+      // payloads, not batches.
+      auto& st = self->state;
+      st.credit += static_cast<int64_t>(amount);
+      while (st.credit > 0 && !st.done()) {
+        auto first = st.next;
+        auto size = st.send_next(self, sink, batch_size);
+        st.credit -= static_cast<int64_t>(in_bytes ? size : st.next - first);
+      }
+    },
+  };
+}
+
+// -- sink actor ---------------------------------------------------------------
+
+behavior sink_actor(stateful_actor<sink_state>* self, actor accumulator,
+                    credit_config credit) {
+  self->set_exit_handler([=](const exit_msg&) { self->quit(); });
+  self->link_to(accumulator);
+  auto received = [=](size_t bytes, size_t num_payloads) {
+    auto& st = self->state;
+    st.received_bytes += bytes;
+    if (st.received_bytes >= st.streaming_amount) {
+      self->send(accumulator, done_atom_v);
+    } else if (credit.window > 0) {
+      st.consumed += credit.in_bytes ? bytes : num_payloads;
+      if (st.consumed >= std::max(credit.window / 2, size_t{1})) {
+        self->send(st.source, credit_atom_v, st.consumed, credit.in_bytes);
+        st.consumed = 0;
+      }
+    }
+  };
+  return {
+    [=](init_atom, size_t streaming_amount) {
+      self->state.streaming_amount = streaming_amount;
+      self->send(accumulator, init_atom_v);
+      start_mailbox_sampling(self);
+      if (credit.window == 0)
+        return make_message(send_atom_v);
+      self->state.source = actor_cast<actor>(self->current_sender());
+      return make_message(credit_atom_v, credit.window, credit.in_bytes);
+    },
+    [=](const payload& p) { received(p.size(), 1); },
+    [=](const compressed_payload& p) { received(p.size(), 1); },
+    [=](const record_batch& xs) { received(xs.size(), 1); },
+    [=](const std::vector<payload>& batch) {
+      size_t bytes = 0;
+      for (auto& p : batch)
+        bytes += p.size();
+      received(bytes, batch.size());
+    },
+    [=](probe_atom, microseconds sent) {
+      auto& st = self->state;
+      if (st.received_bytes < st.streaming_amount)
+        record_mailbox_probe(self, "sink", sent);
+    },
+  };
+}
@@ -1,4 +1,7 @@
+#include <atomic>
 #include <chrono>
+#include <cstring>
+#include <memory>
 #include <string>
 #include <thread>
 #include <unistd.h>
@@ -14,7 +17,11 @@
 #include "caf/sec.hpp"
 #include "caf/settings.hpp"
 #include "caf/span.hpp"
+#include "compressed_payload.hpp"
+#include "compression.hpp"
+#include "netem.hpp"
 #include "utility.hpp"
+#include "workload.hpp"
 
 using namespace caf;
 using namespace caf::net;
@@ -37,9 +44,9 @@ ptrdiff_t send(stream_socket sock, const_byte_span payload) {
 error receive(stream_socket sock, byte_span buf) {
   auto data = buf.data();
   auto size = buf.size();
-  auto received = 0;
-  while (received < buf.size()) {
-    auto ret = read(sock, make_span(data, size));
+  size_t received = 0;
+  while (received < size) {
+    auto ret = read(sock, make_span(data + received, size - received));
     if (ret > 0)
       received += ret;
     else if (ret == 0)
@@ -65,9 +72,66 @@ size_t read_size_t(stream_socket sock) {
   return ntohl(amount);
 }
 
+// -- compressed transfer ------------------------------------------------------
+
+// Compressed payloads vary in size, so each one travels as a frame with a
+// 32-bit length prefix.
+
+void run_compressed_server(stream_socket sock, size_t amount,
+                           size_t message_size) {
+  compressed_payload p;
+  byte_buffer recv_buf(message_size);
+  uint32_t frame_size = 0;
+  auto header = make_span(reinterpret_cast<byte*>(&frame_size),
+                          sizeof(frame_size));
+  size_t num_bytes = 0;
+  while (num_bytes < amount) {
+    if (auto err = receive(sock, header)) {
+      if (err == sec::socket_disconnected)
+        break;
+      exit("receive failed", err);
+    }
+    recv_buf.resize(ntohl(frame_size));
+    if (auto err = receive(sock, recv_buf))
+      exit("receive failed", err);
+    binary_deserializer source{nullptr, recv_buf};
+    if (!source.apply_object(p))
+      exit("deserializing failed", source.get_error());
+    num_bytes += p.size();
+  }
+  send(sock, make_span(recv_buf.data(), 1));
+}
+
+void send_compressed(stream_socket sock, size_t amount, size_t message_size,
+                     std::atomic<size_t>& progress) {
+  compressed_payload p(make_payload(message_size));
+  byte_buffer send_buf;
+  size_t sent = 0;
+  while (sent < amount) {
+    send_buf.resize(sizeof(uint32_t));
+    binary_serializer sink{nullptr, send_buf};
+    sink.seek(sizeof(uint32_t));
+    if (!sink.apply_object(p))
+      exit("serializing failed", sink.get_error());
+    auto frame_size = htonl(
+      static_cast<uint32_t>(send_buf.size() - sizeof(uint32_t)));
+    memcpy(send_buf.data(), &frame_size, sizeof(frame_size));
+    if (send(sock, send_buf) <= 0)
+      exit("write failed");
+    sent += p.size();
+    progress = sent;
+  }
+}
+
+// -- plain transfer -----------------------------------------------------------
+
 void run_server(stream_socket sock) {
   const auto amount = read_size_t(sock);
   const auto message_size = read_size_t(sock);
+  if (compression_enabled()) {
+    run_compressed_server(sock, amount, message_size);
+    return;
+  }
   payload p(message_size);
   auto receive_amount = detail::serialized_size(p);
   byte_buffer recv_buf(receive_amount);
@@ -91,9 +155,18 @@ void run_server(stream_socket sock) {
 void run_client(stream_socket sock, size_t amount, size_t message_size) {
   send_size_t(sock, amount);
   send_size_t(sock, message_size);
-  payload p(message_size);
+  auto p = make_payload(message_size);
   size_t sent = 0;
+  auto progress = std::make_shared<std::atomic<size_t>>(0);
+  add_partial_result_dumper([progress, amount](std::ostream& out) {
+    out << "PARTIAL: sent " << *progress << " of " << amount << " bytes"
+        << std::endl;
+  });
   byte_buffer send_buf;
+  if (compression_enabled()) {
+    send_compressed(sock, amount, message_size, *progress);
+    sent = amount;
+  }
   while (sent < amount) {
     binary_serializer sink{nullptr, send_buf};
     if (!sink.apply_object(p))
@@ -103,6 +176,7 @@ void run_client(stream_socket sock, size_t amount, size_t message_size) {
       exit("write failed");
     send_buf.clear();
     sent += p.size();
+    *progress = sent;
   }
   std::array<byte, 1> dummy;
   ptrdiff_t res = 0;
@@ -118,9 +192,14 @@ int main(int argc, char* argv[]) {
   bool is_server = false;
   size_t amount = 1024;
   size_t message_size = 1024;
+  netem_config netem;
+  size_t deadline = 0;
+  workload_config data;
+  std::string compression;
 
   int opt;
-  while ((opt = getopt(argc, argv, "h::p::sca::m::")) != -1) {
+  while ((opt = getopt(argc, argv, "h::p::sca::m::L::J::B::t::z::d::r::"))
+         != -1) {
     switch (opt) {
       case 'h':
         host = std::string(optarg);
@@ -140,12 +219,41 @@ int main(int argc, char* argv[]) {
       case 'm':
         message_size = atoi(optarg);
         break;
+      case 'L':
+        netem.latency_us = atoi(optarg);
+        break;
+      case 'J':
+        netem.jitter_us = atoi(optarg);
+        break;
+      case 'B':
+        netem.bandwidth = strtoull(optarg, nullptr, 10);
+        break;
+      case 't':
+        deadline = atoi(optarg);
+        break;
+      case 'd':
+        data.kind = std::string(optarg);
+        break;
+      case 'r':
+        data.seed = strtoull(optarg, nullptr, 10);
+        break;
+      case 'z':
+        compression = std::string(optarg);
+        break;
       default:
         fprintf(stderr, "Usage: %s [hp] [file...]\n", argv[0]);
         exit(EXIT_FAILURE);
     }
   }
 
+  start_watchdog(std::chrono::seconds(deadline));
+  data.apply();
+  if (!compression.empty()) {
+    codec x;
+    if (!from_string(compression, x))
+      exit("unsupported compression: " + compression);
+    set_codec(x);
+  }
   if (is_server) {
     auto sock = accept();
     if (sock.socket() == invalid_socket)
@@ -154,6 +262,8 @@ int main(int argc, char* argv[]) {
       exit("nodelay failed", err);
     std::cerr << "accepted! Starting benchmark now." << std::endl;
     run_server(sock.socket());
+    if (compression_enabled())
+      print_compression_stats(std::cerr);
   } else if (is_client) {
     if (port == 0)
       exit("port has to be set explicitly");
@@ -166,8 +276,11 @@ int main(int argc, char* argv[]) {
     auto start = now();
     run_client(sock.socket(), amount, message_size);
     end(start);
+    if (compression_enabled())
+      print_compression_stats(std::cerr);
   } else {
-    if (auto socks = make_connected_tcp_socket_pair()) {
+    std::vector<std::unique_ptr<netem_proxy>> proxies;
+    if (auto socks = make_connected_tcp_socket_pair(netem, proxies)) {
       if (auto err = nodelay(socks->first, true))
         exit("nodelay failed", err);
       if (auto err = nodelay(socks->second, true))
@@ -180,6 +293,8 @@ int main(int argc, char* argv[]) {
       run_client(client_guard.socket(), amount, message_size);
       end(start);
       server_t.join();
+      if (compression_enabled())
+        print_compression_stats(std::cerr);
     } else {
       exit("make_connected_tcp_socket_pair failed", socks.error());
     }
@@ -2,9 +2,12 @@
 
 #include <chrono>
 #include <cstdlib>
+#include <mutex>
 #include <string>
+#include <thread>
 #include <utility>
 
+#include "caf/actor_system_config.hpp"
 #include "caf/error.hpp"
 #include "caf/expected.hpp"
 #include "caf/ip_endpoint.hpp"
@@ -13,8 +16,29 @@
 #include "caf/net/stream_socket.hpp"
 #include "caf/net/tcp_accept_socket.hpp"
 #include "caf/net/tcp_stream_socket.hpp"
+#include "caf/settings.hpp"
 #include "caf/uri.hpp"
 
+namespace {
+
+size_t scheduler_threads = 1;
+
+// Zero keeps the middleman default.
+size_t middleman_workers = 0;
+
+std::mutex dumpers_mtx;
+
+std::vector<std::function<void(std::ostream&)>> dumpers;
+
+[[noreturn]] void terminate_run(int exit_code) {
+  dump_partial_results(std::cerr);
+  std::cout.flush();
+  std::cerr.flush();
+  std::_Exit(exit_code);
+}
+
+} // namespace
+
 bench_mode convert(const std::string& str) {
   if (str == "netBench")
     return bench_mode::net;
@@ -81,13 +105,59 @@ caf::net::socket_guard<caf::net::tcp_stream_socket> connect(std::string host,
   return make_socket_guard(tcp_stream_socket(invalid_socket_id));
 }
 
+void share_thread_settings(const caf::actor_system_config& main_cfg) {
+  scheduler_threads = caf::get_or(main_cfg.content, "caf.scheduler.max-threads",
+                                  size_t{1});
+  middleman_workers = caf::get_or(main_cfg.content, "caf.middleman.workers",
+                                  size_t{0});
+  std::cerr << "scheduler threads: " << scheduler_threads
+            << ", middleman workers: "
+            << (middleman_workers > 0 ? std::to_string(middleman_workers)
+                                      : std::string{"default"})
+            << std::endl;
+}
+
+void apply_thread_settings(caf::actor_system_config& node_cfg) {
+  caf::put(node_cfg.content, "caf.scheduler.max-threads", scheduler_threads);
+  if (middleman_workers > 0)
+    caf::put(node_cfg.content, "caf.middleman.workers", middleman_workers);
+}
+
+void add_partial_result_dumper(std::function<void(std::ostream&)> f) {
+  std::lock_guard<std::mutex> guard{dumpers_mtx};
+  dumpers.emplace_back(std::move(f));
+}
+
+void dump_partial_results(std::ostream& out) {
+  // Dumpers may take locks of their own, so they run without `dumpers_mtx`.
+  std::vector<std::function<void(std::ostream&)>> xs;
+  {
+    std::lock_guard<std::mutex> guard{dumpers_mtx};
+    xs = dumpers;
+  }
+  for (auto& f : xs)
+    f(out);
+}
+
+void start_watchdog(std::chrono::seconds timeout) {
+  if (timeout.count() == 0)
+    return;
+  std::thread{[timeout] {
+    std::this_thread::sleep_for(timeout);
+    std::cerr << "ERROR: deadline of " << timeout.count() << "s exceeded"
+              << std::endl;
+    terminate_run(deadline_exit_code);
+  }}.detach();
+}
+
 void exit(const std::string& msg, const caf::error& err) {
   std::cerr << "ERROR: ";
   if (msg != "")
     std::cerr << msg;
   if (err)
-    std::cerr << ": " << to_string(err) << std::endl;
-  std::abort();
+    std::cerr << ": " << to_string(err);
+  std::cerr << std::endl;
+  terminate_run(EXIT_FAILURE);
 }
 
 void exit(const caf::error& err) {
@@ -0,0 +1,198 @@
+#include "workload.hpp"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstring>
+#include <random>
+
+#include "caf/binary_serializer.hpp"
+#include "caf/byte_buffer.hpp"
+#include "caf/config_option_adder.hpp"
+#include "caf/config_option_set.hpp"
+#include "caf/detail/serialized_size.hpp"
+#include "caf/message.hpp"
+#include "type_ids.hpp"
+#include "utility.hpp"
+
+using namespace caf;
+
+namespace {
+
+constexpr std::array<const char*, 32> vocabulary{
+  "the",     "of",      "and",    "to",      "in",     "request", "server",
+  "client",  "node",    "actor",  "message", "error",  "timeout", "ok",
+  "latency", "payload", "stream", "sink",    "source", "value",   "status",
+  "user",    "session", "cache",  "hit",     "miss",   "retry",   "queue",
+  "worker",  "job",     "done",   "failed",
+};
+
+constexpr std::array<const char*, 6> units{"ms", "us", "kB", "C", "%", "rpm"};
+
+std::atomic<workload> selected{workload::zeros};
+
+std::atomic<uint64_t> base_seed{0};
+
+/// Returns a generator whose sequence depends only on the configured seed and
+/// `stream`, regardless of the calling thread or the order of calls.
+std::mt19937_64 generator(uint64_t stream) {
+  // seed_seq keeps only the lower 32 bits of each value.
+  auto seed = base_seed.load();
+  std::seed_seq seq{seed & 0xFFFFFFFF, seed >> 32, stream & 0xFFFFFFFF,
+                    stream >> 32};
+  return std::mt19937_64{seq};
+}
+
+/// Picks frequent words more often than rare ones, like natural text.
+const char* pick_word(std::mt19937_64& gen) {
+  std::geometric_distribution<size_t> dist{0.15};
+  return vocabulary[std::min(dist(gen), vocabulary.size() - 1)];
+}
+
+void fill_random(std::mt19937_64& gen, byte_span buf) {
+  size_t pos = 0;
+  while (pos < buf.size()) {
+    auto x = gen();
+    auto n = std::min(sizeof(x), buf.size() - pos);
+    memcpy(buf.data() + pos, &x, n);
+    pos += n;
+  }
+}
+
+void fill_text(std::mt19937_64& gen, byte_span buf) {
+  size_t pos = 0;
+  while (pos < buf.size()) {
+    auto word = pick_word(gen);
+    auto n = std::min(strlen(word), buf.size() - pos);
+    memcpy(buf.data() + pos, word, n);
+    pos += n;
+    if (pos < buf.size())
+      buf[pos++] = static_cast<byte>(' ');
+  }
+}
+
+record make_record(std::mt19937_64& gen, uint64_t id) {
+  std::uniform_int_distribution<size_t> num_tags{1, 4};
+  std::uniform_int_distribution<size_t> num_measurements{1, 8};
+  std::uniform_int_distribution<size_t> unit{0, units.size() - 1};
+  std::normal_distribution<double> value{100.0, 25.0};
+  record result;
+  result.id = id;
+  result.name = std::string(pick_word(gen)) + '-' + pick_word(gen) + '-'
+                + std::to_string(gen() % 10000);
+  for (size_t i = num_tags(gen); i > 0; --i)
+    result.tags.emplace(pick_word(gen), pick_word(gen));
+  auto timestamp = static_cast<int64_t>(gen() % 1'000'000'000);
+  for (size_t i = num_measurements(gen); i > 0; --i) {
+    timestamp += static_cast<int64_t>(gen() % 1000);
+    result.measurements.emplace_back(
+      measurement{units[unit(gen)], timestamp, value(gen)});
+  }
+  return result;
+}
+
+record_batch generate_records(std::mt19937_64& gen, size_t size) {
+  record_batch result;
+  result.nominal_size = size;
+  size_t serialized = 0;
+  do {
+    result.records.emplace_back(make_record(gen, result.records.size()));
+    serialized += detail::serialized_size(result.records.back());
+  } while (serialized < size);
+  return result;
+}
+
+void fill_structured(std::mt19937_64& gen, byte_span buf) {
+  byte_buffer serialized;
+  binary_serializer sink{nullptr, serialized};
+  auto batch = generate_records(gen, buf.size());
+  if (!sink.apply_object(batch))
+    exit("serializing records failed", sink.get_error());
+  memcpy(buf.data(), serialized.data(),
+         std::min(buf.size(), serialized.size()));
+}
+
+} // namespace
+
+const char* to_string(workload x) {
+  switch (x) {
+    case workload::random:
+      return "random";
+    case workload::text:
+      return "text";
+    case workload::structured:
+      return "structured";
+    default:
+      return "zeros";
+  }
+}
+
+bool from_string(const std::string& str, workload& x) {
+  for (auto candidate : {workload::zeros, workload::random, workload::text,
+                         workload::structured}) {
+    if (str == to_string(candidate)) {
+      x = candidate;
+      return true;
+    }
+  }
+  return false;
+}
+
+void workload_config::add_options(config_option_set& opts) {
+  config_option_adder{opts, "data"}
+    .add(kind, "kind", "'zeros', 'random', 'text' or 'structured'")
+    .add(seed, "seed", "seed of the payload generators");
+}
+
+void workload_config::apply() const {
+  workload x;
+  if (!from_string(kind, x))
+    exit("invalid data kind: " + kind);
+  set_workload(x, seed);
+}
+
+void set_workload(workload x, uint64_t seed) {
+  selected = x;
+  base_seed = seed;
+}
+
+workload current_workload() {
+  return selected;
+}
+
+void fill_payload(byte_span buf, uint64_t stream) {
+  auto x = selected.load();
+  if (x == workload::zeros || buf.empty()) {
+    std::fill(buf.begin(), buf.end(), byte{0});
+    return;
+  }
+  auto gen = generator(stream);
+  switch (x) {
+    case workload::random:
+      fill_random(gen, buf);
+      break;
+    case workload::text:
+      fill_text(gen, buf);
+      break;
+    default:
+      fill_structured(gen, buf);
+  }
+}
+
+payload make_payload(size_t size, uint64_t stream) {
+  payload result(size);
+  if (selected != workload::zeros)
+    fill_payload(make_span(result), stream);
+  return result;
+}
+
+record_batch make_record_batch(size_t size, uint64_t stream) {
+  auto gen = generator(stream);
+  return generate_records(gen, size);
+}
+
+message make_workload_message(size_t size, uint64_t stream) {
+  if (selected == workload::structured)
+    return make_message(make_record_batch(size, stream));
+  return make_message(make_payload(size, stream));
+}